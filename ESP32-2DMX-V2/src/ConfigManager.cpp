@@ -1,8 +1,3 @@
-#define DEVICE_NAME "default_device_name"
-#define DEFAULT_PIXELS 100 // Define DEFAULT_PIXELS with an appropriate value
-#define DEVICE_NAME "default_device_name"
-#define DEFAULT_PIXELS 100 // Define DEFAULT_PIXELS with an appropriate value
-
 #include "ConfigManager.h"
 
 const char* ConfigManager::CONFIG_FILE = "/config.json";
@@ -18,7 +13,7 @@ bool ConfigManager::load(Config& config) {
         return false;
     }
 
-    StaticJsonDocument<1024> doc;
+    StaticJsonDocument<2048> doc;
     DeserializationError error = deserializeJson(doc, file);
     file.close();
 
@@ -45,21 +40,48 @@ bool ConfigManager::load(Config& config) {
     config.artnetSubnet = doc["artnetSubnet"] | 0;
     config.artnetUniverse = doc["artnetUniverse"] | 0;
     config.dmxStartAddress = doc["dmxStartAddress"] | 1;
+    config.sacnEnabled = doc["sacnEnabled"] | true;
+    config.mergeMode = doc["mergeMode"] | true;
+
+    // DMX端口配置
+    JsonArray dmxInput = doc["dmxInput"];
+    JsonArray dmxSlotMode = doc["dmxSlotMode"];
+    JsonArray dmxSlotCount = doc["dmxSlotCount"];
+    JsonArray dmxRefreshRate = doc["dmxRefreshRate"];
+    for (int i = 0; i < 2; i++) {
+        config.dmxInput[i] = dmxInput[i] | false;
+        config.dmxSlotMode[i] = dmxSlotMode[i] | 2;  // 默认满帧
+        config.dmxSlotCount[i] = dmxSlotCount[i] | 512;
+        config.dmxRefreshRate[i] = dmxRefreshRate[i] | 0;
+    }
 
     // 像素配置
     config.pixelCount = doc["pixelCount"] | DEFAULT_PIXELS;
     config.pixelType = doc["pixelType"] | 0;
     config.pixelEnabled = doc["pixelEnabled"] | true;
+    config.pixelGamma = doc["pixelGamma"] | 1.0f;
+    config.pixelDither = doc["pixelDither"] | false;
+    config.pixelOutputs = doc["pixelOutputs"] | 1;
+
+    JsonArray pixelPin = doc["pixelPin"];
+    JsonArray pixelLength = doc["pixelLength"];
+    JsonArray pixelUniverse = doc["pixelUniverse"];
+    for (int i = 0; i < PIXEL_MAX_OUTPUTS; i++) {
+        config.pixelPin[i] = pixelPin[i] | 0xFF;
+        config.pixelLength[i] = pixelLength[i] | 0;
+        config.pixelUniverse[i] = pixelUniverse[i] | 0xFFFF;
+    }
 
     // 系统配置
     config.rdmEnabled = doc["rdmEnabled"] | true;
+    config.rdmInterval = doc["rdmInterval"] | 4;
     config.brightness = doc["brightness"] | 255;
 
     return true;
 }
 
 bool ConfigManager::save(const Config& config) {
-    StaticJsonDocument<1024> doc;
+    StaticJsonDocument<2048> doc;
 
     // 网络配置
     doc["deviceName"] = config.deviceName;
@@ -80,14 +102,41 @@ bool ConfigManager::save(const Config& config) {
     doc["artnetSubnet"] = config.artnetSubnet;
     doc["artnetUniverse"] = config.artnetUniverse;
     doc["dmxStartAddress"] = config.dmxStartAddress;
+    doc["sacnEnabled"] = config.sacnEnabled;
+    doc["mergeMode"] = config.mergeMode;
+
+    // DMX端口配置
+    JsonArray dmxInput = doc.createNestedArray("dmxInput");
+    JsonArray dmxSlotMode = doc.createNestedArray("dmxSlotMode");
+    JsonArray dmxSlotCount = doc.createNestedArray("dmxSlotCount");
+    JsonArray dmxRefreshRate = doc.createNestedArray("dmxRefreshRate");
+    for (int i = 0; i < 2; i++) {
+        dmxInput.add(config.dmxInput[i]);
+        dmxSlotMode.add(config.dmxSlotMode[i]);
+        dmxSlotCount.add(config.dmxSlotCount[i]);
+        dmxRefreshRate.add(config.dmxRefreshRate[i]);
+    }
 
     // 像素配置
     doc["pixelCount"] = config.pixelCount;
     doc["pixelType"] = config.pixelType;
     doc["pixelEnabled"] = config.pixelEnabled;
+    doc["pixelGamma"] = config.pixelGamma;
+    doc["pixelDither"] = config.pixelDither;
+    doc["pixelOutputs"] = config.pixelOutputs;
+
+    JsonArray pixelPin = doc.createNestedArray("pixelPin");
+    JsonArray pixelLength = doc.createNestedArray("pixelLength");
+    JsonArray pixelUniverse = doc.createNestedArray("pixelUniverse");
+    for (int i = 0; i < PIXEL_MAX_OUTPUTS; i++) {
+        pixelPin.add(config.pixelPin[i]);
+        pixelLength.add(config.pixelLength[i]);
+        pixelUniverse.add(config.pixelUniverse[i]);
+    }
 
     // 系统配置
     doc["rdmEnabled"] = config.rdmEnabled;
+    doc["rdmInterval"] = config.rdmInterval;
     doc["brightness"] = config.brightness;
 
     File file = LittleFS.open(CONFIG_FILE, "w");
@@ -126,13 +175,32 @@ void ConfigManager::setDefaults(Config& config) {
     config.artnetSubnet = 0;
     config.artnetUniverse = 0;
     config.dmxStartAddress = 1;
+    config.sacnEnabled = true;
+    config.mergeMode = true;  // HTP
+
+    // DMX端口配置
+    for (int i = 0; i < 2; i++) {
+        config.dmxInput[i] = false;
+        config.dmxSlotMode[i] = 2;  // 满帧
+        config.dmxSlotCount[i] = 512;
+        config.dmxRefreshRate[i] = 0;
+    }
 
     // 像素配置
     config.pixelCount = DEFAULT_PIXELS;
     config.pixelType = 0;
     config.pixelEnabled = true;
+    config.pixelGamma = 1.0f;
+    config.pixelDither = false;
+    config.pixelOutputs = 1;
+    for (int i = 0; i < PIXEL_MAX_OUTPUTS; i++) {
+        config.pixelPin[i] = 0xFF;       // 板载默认引脚
+        config.pixelLength[i] = 0;       // 使用 pixelCount
+        config.pixelUniverse[i] = 0xFFFF;  // 自动
+    }
 
     // 系统配置
     config.rdmEnabled = true;
+    config.rdmInterval = 4;  // 满帧时RDM满载的DMX帧率不低于原来的约3/4
     config.brightness = 255;
 }
@@ -3,6 +3,7 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <LittleFS.h>
+#include "config.h"
 
 class ConfigManager {
 public:
@@ -19,14 +20,30 @@ public:
         uint8_t artnetSubnet;
         uint8_t artnetUniverse;
         uint16_t dmxStartAddress;
+        bool sacnEnabled;            // 同时接收E1.31(sACN)
+        bool mergeMode;              // 多源合并: true 为HTP, false 为LTP
+
+        // DMX端口配置(A/B)
+        bool dmxInput[2];            // true 时端口作为DMX输入
+        uint8_t dmxSlotMode[2];      // 0 自动, 1 固定, 2 满帧
+        uint16_t dmxSlotCount[2];    // 固定模式下的槽位数
+        uint16_t dmxRefreshRate[2];  // 目标刷新率(Hz), 0 尽可能快
         
         // 像素配置
         uint16_t pixelCount;
         uint8_t pixelType;
         bool pixelEnabled;
+        float pixelGamma;            // 像素伽马, 1.0 为线性
+        bool pixelDither;            // 像素时间抖动
+        // 并行像素输出, 最多 PIXEL_MAX_OUTPUTS 路
+        uint8_t pixelOutputs;        // 启用的输出路数
+        uint8_t pixelPin[PIXEL_MAX_OUTPUTS];        // 数据引脚, 0xFF 使用板载默认引脚
+        uint16_t pixelLength[PIXEL_MAX_OUTPUTS];    // 每路像素数, 0 使用 pixelCount
+        uint16_t pixelUniverse[PIXEL_MAX_OUTPUTS];  // 起始端口地址, 0xFFFF 接在前一路之后
         
         // 系统配置
         bool rdmEnabled;
+        uint8_t rdmInterval;         // 两个RDM窗口之间至少发送的DMX帧数
         uint8_t brightness;
     };
 
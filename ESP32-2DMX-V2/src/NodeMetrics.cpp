@@ -0,0 +1,60 @@
+#include "NodeMetrics.h"
+#include <WiFi.h>
+
+NodeMetrics::NodeMetrics()
+    : artDmxPackets(0)
+    , packetsDropped(0)
+    , pixelShowUs(0)
+    , lastArtDmx(0)
+    , lastDropped(0)
+    , lastSample(0)
+    , sampled(false) {
+    memset(value, 0, sizeof(value));
+    memset(lowest, 0, sizeof(lowest));
+    memset(highest, 0, sizeof(highest));
+    memset(recorded, 0, sizeof(recorded));
+}
+
+// 由低优先级任务每秒调用一次
+void NodeMetrics::sample(uint32_t dmxRateA, uint32_t dmxRateB) {
+    uint32_t now = millis();
+    uint32_t elapsed = now - lastSample;
+    if (elapsed == 0) return;
+
+    uint32_t artDmx = artDmxPackets.load(std::memory_order_relaxed);
+    uint32_t dropped = packetsDropped.load(std::memory_order_relaxed);
+
+    if (sampled) {
+        store(METRIC_ARTDMX_RATE, (uint64_t)(artDmx - lastArtDmx) * 1000 / elapsed);
+        store(METRIC_PACKETS_DROPPED, (uint64_t)(dropped - lastDropped) * 1000 / elapsed);
+    }
+    store(METRIC_DMX_A_RATE, dmxRateA);
+    store(METRIC_DMX_B_RATE, dmxRateB);
+    store(METRIC_PIXEL_SHOW, pixelShowUs.load(std::memory_order_relaxed));
+    store(METRIC_FREE_HEAP, ESP.getFreeHeap() / 1024);
+    store(METRIC_WIFI_RSSI, WiFi.isConnected() ? WiFi.RSSI() : 0);
+
+    lastArtDmx = artDmx;
+    lastDropped = dropped;
+    lastSample = now;
+    sampled = true;
+}
+
+void NodeMetrics::store(uint8_t sensor, int32_t sampleValue) {
+    if (sampleValue > INT16_MAX) sampleValue = INT16_MAX;
+    if (sampleValue < INT16_MIN) sampleValue = INT16_MIN;
+
+    int16_t v = sampleValue;
+    if (!sampled || v < lowest[sensor]) lowest[sensor] = v;
+    if (!sampled || v > highest[sensor]) highest[sensor] = v;
+    value[sensor] = v;
+}
+
+void NodeMetrics::resetRange(uint8_t sensor) {
+    lowest[sensor] = value[sensor];
+    highest[sensor] = value[sensor];
+}
+
+void NodeMetrics::record(uint8_t sensor) {
+    recorded[sensor] = value[sensor];
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+// 以RDM传感器形式对外提供的节点指标
+enum MetricSensor : uint8_t {
+    METRIC_ARTDMX_RATE = 0,     // ArtDmx 包/秒
+    METRIC_DMX_A_RATE,          // DMX A 实际帧率
+    METRIC_DMX_B_RATE,          // DMX B 实际帧率
+    METRIC_PIXEL_SHOW,          // 像素刷新耗时(us)
+    METRIC_FREE_HEAP,           // 空闲堆(KB)
+    METRIC_WIFI_RSSI,           // WiFi信号强度(dBm)
+    METRIC_PACKETS_DROPPED,     // 丢弃包/秒: 超长/读取失败/预筛选/序号过期, 以及收包预算用尽次数
+    METRIC_COUNT
+};
+
+// 节点性能计数: 热路径只做原子自增或写入, 不加锁;
+// sample() 每秒换算成传感器值并记录最小/最大值
+struct NodeMetrics {
+    std::atomic<uint32_t> artDmxPackets;
+    std::atomic<uint32_t> packetsDropped;
+    std::atomic<uint32_t> pixelShowUs;
+
+    int16_t value[METRIC_COUNT];
+    int16_t lowest[METRIC_COUNT];
+    int16_t highest[METRIC_COUNT];
+    int16_t recorded[METRIC_COUNT];
+
+    NodeMetrics();
+
+    void countArtDmx() { artDmxPackets.fetch_add(1, std::memory_order_relaxed); }
+    void countDropped() { packetsDropped.fetch_add(1, std::memory_order_relaxed); }
+    void setPixelShow(uint32_t us) { pixelShowUs.store(us, std::memory_order_relaxed); }
+
+    void sample(uint32_t dmxRateA, uint32_t dmxRateB);
+    void resetRange(uint8_t sensor);   // 最小/最大值重置为当前值
+    void record(uint8_t sensor);       // 保存当前值
+
+private:
+    uint32_t lastArtDmx;
+    uint32_t lastDropped;
+    uint32_t lastSample;
+    bool sampled;
+
+    void store(uint8_t sensor, int32_t sampleValue);
+};
+
+extern NodeMetrics gMetrics;
@@ -1,19 +1,57 @@
 #include "ArtnetNode.h"
+#include <esp_random.h>
+#include "NodeMetrics.h"
+
+static_assert(ARTNET_ROUTE_SLOTS >= 2 * ARTNET_MAX_ROUTES, "route hash table too small");
+static_assert((ARTNET_ROUTE_SLOTS & (ARTNET_ROUTE_SLOTS - 1)) == 0, "route slots must be a power of 2");
 
 // 静态成员初始化
 const uint8_t ArtnetNode::ARTNET_ID[8] = {'A', 'r', 't', '-', 'N', 'e', 't', 0};
 
+// 逐字节取最大值(SWAR), 一次比较4个通道
+static inline uint32_t maxBytes4(uint32_t a, uint32_t b) {
+    const uint32_t high = 0x80808080;
+    uint32_t diff = a ^ b;
+    uint32_t low = (a | high) - (b & ~high);            // 低7位比较, 字节间不借位
+    uint32_t ge = ((diff & a) | (~diff & low)) & high;  // 每字节最高位: a >= b
+    uint32_t mask = (ge >> 7) * 0xFF;
+    return (a & mask) | (b & ~mask);
+}
+
 ArtnetNode::ArtnetNode()
-    : dmx(nullptr)
+    : configPending(false)
+    , receiveBudget(ARTNET_RX_BUDGET)
     , pixels(nullptr)
+    , syncMode(false)
+    , lastSyncTime(0)
+    , syncSourceIp(0)
+    , routeGeneration(0)
+    , broadcastIp(0xFFFFFFFF)
+    , replyPageCount(0)
+    , replyDirty(true)
+    , replySignature(0)
+    , replyPending(false)
+    , replyDueTime(0)
+    , lastReplyTime(0)
+    , replyTargets(0)
+    , replyCounter(0)
     , dmxCallback(nullptr)
     , rdmCallback(nullptr)
     , pixelCallback(nullptr) {
+    dmxPorts[0] = nullptr;
+    dmxPorts[1] = nullptr;
+    portMUX_INITIALIZE(&configLock);
+    memset(sources, 0, sizeof(sources));
+    memset(inputs, 0, sizeof(inputs));
+    memset(controllers, 0, sizeof(controllers));
+    memset(&nodeUid, 0, sizeof(nodeUid));
+    clearRoutes();
     initializeDefaults();
 }
 
 ArtnetNode::~ArtnetNode() {
     udp.stop();
+    releaseAllSources();
 }
 
 void ArtnetNode::initializeDefaults() {
@@ -28,43 +66,83 @@ void ArtnetNode::initializeDefaults() {
     config.pixelCount = 170;
     config.pixelType = 0;
     config.mergeMode = true;
+    config.rdmEnabled = true;
 
     // 状态初始化
     memset(&status, 0, sizeof(Status));
+    memset(&stats, 0, sizeof(Stats));
     status.firmware = 1;
     status.ports = 1;
-    status.portTypes[0] = 0x80;  // 输出端口
     status.version = ARTNET_VERSION;
+    updateStatus();
+
+    rebuildRoutes();
 }
 
 bool ArtnetNode::begin() {
     // 获取网络信息
-    IPAddress localIP = WiFi.localIP();
-    uint32_t ip = localIP;
-    memcpy(status.ip, &ip, 4);
+    WiFi.macAddress(status.mac);
+    checkNetworkAddress();
+    replyDirty = true;
 
     // 启动UDP
     if (!udp.begin(ARTNET_PORT)) {
         return false;
     }
 
-    // 初始化缓冲区
-    memset(dmxBuffer, 0, sizeof(dmxBuffer));
-    memset(pixelBuffer, 0, sizeof(pixelBuffer));
-
     return true;
 }
 
+// 每次唤醒尽量排空接收队列, 最多处理 receiveBudget 个包后让出CPU
 void ArtnetNode::update() {
-    int packetSize = udp.parsePacket();
-    if (packetSize == 0) return;
+    applyPendingConfig();
+    checkNetworkAddress();
+    checkSyncTimeout();
+    checkPixelTimeout();
+    serviceInputs();
+    serviceRdm();
+    servicePollReply();
+
+    for (uint8_t i = 0; i < receiveBudget; i++) {
+        int packetSize = udp.parsePacket();
+        if (packetSize <= 0) return;
+        processPacket(packetSize);
+    }
+
+    // 预算用尽, 剩余数据包留到下次唤醒, 计入丢弃指标以反映余量不足
+    stats.budgetExhausted++;
+    gMetrics.countDropped();
+}
 
-    // 读取数据包
-    int length = udp.read(artnetBuffer, sizeof(artnetBuffer));
-    if (length < 10) return;
+void ArtnetNode::processPacket(int packetSize) {
+    // 先只读包头, 不需要的包直接丢弃, 不拷贝负载
+    int length = udp.read(artnetBuffer, ART_DMX_HEADER_SIZE);
+    if (length <= 0) {
+        udp.flush();
+        stats.packetsDropped++;
+        gMetrics.countDropped();
+        return;
+    }
+    if (!acceptHeader(artnetBuffer, length)) {
+        udp.flush();
+        stats.packetsFiltered++;
+        gMetrics.countDropped();
+        return;
+    }
 
-    // 验证Art-Net包
-    if (!validatePacket(artnetBuffer, length)) return;
+    // 读取其余部分, 超出缓冲区的部分随 flush 丢弃
+    if (packetSize > length) {
+        int rest = udp.read(artnetBuffer + length, sizeof(artnetBuffer) - length);
+        if (rest > 0) length += rest;
+    }
+    udp.flush();
+
+    if (packetSize > (int)sizeof(artnetBuffer)) {
+        stats.packetsDropped++;
+        gMetrics.countDropped();
+        return;
+    }
+    stats.packetsProcessed++;
 
     // 解析操作码
     uint16_t opcode = artnetBuffer[8] | (artnetBuffer[9] << 8);
@@ -72,111 +150,402 @@ void ArtnetNode::update() {
     // 处理不同类型的Art-Net包
     switch (opcode) {
         case OpPoll:
-            handleArtPoll();
+            handleArtPoll((uint32_t)udp.remoteIP());
             break;
         case OpDmx:
-            handleArtDmx(artnetBuffer, length);
+            gMetrics.countArtDmx();
+            handleArtDmx(artnetBuffer, length, (uint32_t)udp.remoteIP());
+            break;
+        case OpNzs:
+            handleArtNzs(artnetBuffer, length);
+            break;
+        case OpInput:
+            handleArtInput(artnetBuffer, length, (uint32_t)udp.remoteIP());
             break;
         case OpAddress:
-            handleArtAddress(artnetBuffer, length);
+            handleArtAddress(artnetBuffer, length, (uint32_t)udp.remoteIP());
             break;
         case OpRdm:
-            handleArtRdm(artnetBuffer, length);
+            handleArtRdm(artnetBuffer, length, (uint32_t)udp.remoteIP());
+            break;
+        case OpTodRequest:
+            handleArtTodRequest(artnetBuffer, length, (uint32_t)udp.remoteIP());
+            break;
+        case OpTodControl:
+            handleArtTodControl(artnetBuffer, length, (uint32_t)udp.remoteIP());
             break;
         case OpSync:
-            handleArtSync();
+            handleArtSync((uint32_t)udp.remoteIP());
             break;
     }
 }
 
-void ArtnetNode::handleArtDmx(uint8_t* data, uint16_t length) {
+void ArtnetNode::handleArtDmx(uint8_t* data, uint16_t length, uint32_t sourceIp) {
     if (length < 18) return;  // DMX数据包最小长度
 
     uint8_t sequence = data[12];
-    uint8_t physical = data[13];
-    uint8_t subnet = data[14] >> 4;
-    uint8_t universe = data[14] & 0x0F;
+    uint16_t portAddress = ((data[15] & 0x7F) << 8) | data[14];
     uint16_t dmxLength = (data[16] << 8) | data[17];
 
-    // 检查是否是目标宇宙
-    if (subnet != config.subnet || universe != config.universe) {
+    // 查路由表, 非本节点宇宙直接丢弃
+    const Route* route = findRoute(portAddress);
+    if (!route) {
         return;
     }
+    syncSourceIp = sourceIp;
 
     // 限制DMX数据长度
     if (dmxLength > ARTNET_DMX_LENGTH) {
         dmxLength = ARTNET_DMX_LENGTH;
     }
+    if (dmxLength > length - 18) {
+        dmxLength = length - 18;
+    }
+
+    outputFrame(route, sourceIp, &data[18], dmxLength, sequence);
+}
+
+// ArtNzs: 非零起始码帧不参与合并和像素输出, 按原长度直接送往DMX端口
+void ArtnetNode::handleArtNzs(uint8_t* data, uint16_t length) {
+    if (length < ART_DMX_HEADER_SIZE) return;
 
-    // 复制DMX数据
-    memcpy(dmxBuffer, &data[18], dmxLength);
+    uint8_t startCode = data[13];
+    uint16_t portAddress = ((data[15] & 0x7F) << 8) | data[14];
+    uint16_t slots = (data[16] << 8) | data[17];
+
+    const Route* route = findRoute(portAddress);
+    if (!route || startCode == 0 || !route->dmxMask) {
+        return;
+    }
+    if (slots > ARTNET_DMX_LENGTH) {
+        slots = ARTNET_DMX_LENGTH;
+    }
+    if (slots > length - ART_DMX_HEADER_SIZE) {
+        slots = length - ART_DMX_HEADER_SIZE;
+    }
+
+    for (uint8_t port = 0; port < 2; port++) {
+        if ((route->dmxMask & (1 << port)) && dmxPorts[port]) {
+            dmxPorts[port]->sendAlternateFrame(startCode, &data[ART_DMX_HEADER_SIZE], slots);
+        }
+    }
+}
+
+// 把一帧送往路由的全部输出, 网络数据与本地输入共用
+void ArtnetNode::outputFrame(const Route* route, uint32_t sourceIp, uint8_t* data, uint16_t dmxLength,
+                             uint8_t sequence) {
+    // 直接使用调用方缓冲区中的负载, 多源时替换为合并结果
+    uint8_t* payload = mergeFrame(route - routes, sourceIp, data, dmxLength, sequence);
+    if (!payload) {
+        return;
+    }
 
     // 调用DMX回调
     if (dmxCallback) {
-        dmxCallback(universe, dmxBuffer, dmxLength);
+        dmxCallback(route->portAddress, payload, dmxLength);
     }
 
-    // 更新DMX输出
-    if (dmx) {
-        dmx->write(dmxBuffer, dmxLength);
+    // 更新DMX输出, 同步模式下只写暂存帧
+    for (uint8_t port = 0; port < 2; port++) {
+        if ((route->dmxMask & (1 << port)) && dmxPorts[port]) {
+            if (syncMode) {
+                dmxPorts[port]->stageChannels(payload, dmxLength);
+            } else {
+                dmxPorts[port]->setChannels(payload, dmxLength);
+            }
+        }
     }
 
     // 处理像素数据
-    if (pixels && config.pixelCount > 0) {
-        uint16_t pixelLength = config.pixelCount * 3;
+    if (pixels && route->pixelSegment != ROUTE_NO_PIXEL) {
+        uint16_t pixelLength = PIXELS_PER_UNIVERSE * 3;
         if (pixelLength > dmxLength) {
             pixelLength = dmxLength;
         }
-        memcpy(pixelBuffer, dmxBuffer, pixelLength);
         if (pixelCallback) {
-            pixelCallback(pixelBuffer, pixelLength);
+            pixelCallback(payload, pixelLength);
+        }
+
+        // 段在本帧中重复出现说明其余段不会再来(控制器少发或丢包), 先刷新已到的部分
+        uint16_t segmentBit = 1 << route->pixelSegment;
+        if (!syncMode && (pixelPendingMask & segmentBit)) {
+            showPixels();
+        }
+        pixels->writeSegment(route->pixelSegment, payload, pixelLength);
+
+        // 所有像素段到齐后统一刷新, 同步模式下等待ArtSync
+        if (!pixelPendingMask) {
+            pixelPendingTime = millis();
+        }
+        pixelPendingMask |= segmentBit;
+        if (!syncMode && (pixelPendingMask & pixelRouteMask) == pixelRouteMask) {
+            showPixels();
         }
-        pixels->update();
     }
 }
 
-void ArtnetNode::handleArtPoll() {
-    sendArtPollReply();
+// 记录控制器并安排回复
+void ArtnetNode::handleArtPoll(uint32_t sourceIp) {
+    schedulePollReply(sourceIp);
+}
+
+// 记录发送ArtPoll的控制器, 作为输入数据的单播目标, 返回其下标
+uint8_t ArtnetNode::recordController(uint32_t ip) {
+    uint8_t slot = 0;
+    for (uint8_t i = 0; i < ARTNET_MAX_CONTROLLERS; i++) {
+        Controller& controller = controllers[i];
+        if (controller.ip == ip) {
+            slot = i;
+            break;
+        }
+        // 优先复用空闲或最久未出现的条目
+        const Controller& current = controllers[slot];
+        if (!controller.ip ||
+            (current.ip && controller.lastSeen < current.lastSeen)) {
+            slot = i;
+        }
+    }
+    controllers[slot].ip = ip;
+    controllers[slot].lastSeen = millis();
+    return slot;
+}
+
+// OpInput: Input[n] bit0 置位时禁用对应输入端口
+void ArtnetNode::handleArtInput(uint8_t* data, uint16_t length, uint32_t sourceIp) {
+    if (length < ART_INPUT_MIN_SIZE) {
+        return;
+    }
+
+    uint16_t numPorts = (data[14] << 8) | data[15];
+    for (uint8_t i = 0; i < ARTNET_MAX_INPUTS && i < numPorts && i < 4; i++) {
+        inputs[i].disabled = data[16 + i] & 0x01;
+    }
+
+    // 规范要求以ArtPollReply确认
+    replyDirty = true;
+    schedulePollReply(sourceIp);
+}
+
+// 延迟回复: 随机抖动避免多个节点同时回复, 窗口内的多个ArtPoll合并为一次回复,
+// 两次回复至少间隔 ARTNET_POLL_REPLY_INTERVAL
+void ArtnetNode::schedulePollReply(uint32_t ip) {
+    replyTargets |= 1 << recordController(ip);
+    if (replyPending) {
+        return;
+    }
+
+    uint32_t now = millis();
+    uint32_t due = now + esp_random() % ARTNET_POLL_REPLY_JITTER;
+    if (lastReplyTime && (int32_t)(lastReplyTime + ARTNET_POLL_REPLY_INTERVAL - due) > 0) {
+        due = lastReplyTime + ARTNET_POLL_REPLY_INTERVAL;
+    }
+    replyDueTime = due;
+    replyPending = true;
 }
 
+void ArtnetNode::servicePollReply() {
+    if (replyPending && (int32_t)(millis() - replyDueTime) >= 0) {
+        sendArtPollReply();
+    }
+}
+
+// 发送全部回复页: 请求方较少时逐个单播, 否则定向广播一次
 void ArtnetNode::sendArtPollReply() {
-    uint8_t reply[239];
-    memset(reply, 0, sizeof(reply));
+    if (replyDirty || pollReplySignature() != replySignature) {
+        buildPollReplies();
+    }
 
-    // ID
-    memcpy(reply, ARTNET_ID, 8);
-    
-    // OpCode
-    reply[8] = OpPollReply & 0xFF;
-    reply[9] = (OpPollReply >> 8) & 0xFF;
-    
-    // IP地址
-    memcpy(reply + 10, status.ip, 4);
-    
-    // 端口
-    reply[14] = (ARTNET_PORT >> 8) & 0xFF;
-    reply[15] = ARTNET_PORT & 0xFF;
-    
-    // 版本信息
-    reply[16] = status.version >> 8;
-    reply[17] = status.version & 0xFF;
-    
-    // 网络设置
-    reply[18] = config.subnet;
-    reply[19] = status.firmware;
-    
-    // 状态
-    reply[21] = status.status1;
-    reply[22] = status.status2;
-    
-    // 名称
-    memcpy(reply + 26, config.shortName, 18);
-    memcpy(reply + 44, config.longName, 64);
-    
-    // 发送回复
-    udp.beginPacket(udp.remoteIP(), udp.remotePort());
-    udp.write(reply, sizeof(reply));
-    udp.endPacket();
+    // NodeReport 计数每次回复递增, 只改写这一字段
+    replyCounter = (replyCounter + 1) % 10000;
+    for (uint8_t page = 0; page < replyPageCount; page++) {
+        snprintf((char*)&pollReplies[page][108], 64, "#0001 [%04u] OK", replyCounter);
+    }
+
+    uint32_t targets[ARTNET_MAX_CONTROLLERS];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < ARTNET_MAX_CONTROLLERS; i++) {
+        if ((replyTargets & (1 << i)) && controllers[i].ip) {
+            targets[count++] = controllers[i].ip;
+        }
+    }
+    if (count == 0 || count > ARTNET_POLL_UNICAST_MAX) {
+        targets[0] = broadcastIp;
+        count = 1;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        for (uint8_t page = 0; page < replyPageCount; page++) {
+            udp.beginPacket(IPAddress(targets[i]), ARTNET_PORT);
+            udp.write(pollReplies[page], ARTNET_POLL_REPLY_SIZE);
+            udp.endPacket();
+        }
+    }
+
+    replyTargets = 0;
+    replyPending = false;
+    lastReplyTime = millis();
+}
+
+// 回复中随运行状态变化的部分: 各路由的合并状态和输入端口状态
+uint32_t ArtnetNode::pollReplySignature() const {
+    uint32_t signature = config.mergeMode ? 0x80000000 : 0;
+    for (uint8_t i = 0; i < routeCount; i++) {
+        if (isMerging(i)) {
+            signature |= 1 << i;
+        }
+    }
+    for (uint8_t i = 0; i < ARTNET_MAX_INPUTS; i++) {
+        if (inputs[i].length) signature |= 1 << (16 + i * 2);
+        if (inputs[i].disabled) signature |= 1 << (17 + i * 2);
+    }
+    return signature;
+}
+
+// 生成回复页: 每页最多4个端口, 同页端口共用Net/SubNet, BindIndex 从1开始
+void ArtnetNode::buildPollReplies() {
+    struct ReplyPort {
+        uint16_t address;
+        uint8_t type;
+        uint8_t goodInput;
+        uint8_t goodOutputA;
+        uint8_t goodOutputB;
+    };
+    ReplyPort ports[ARTNET_MAX_REPLY_PORTS];
+    uint8_t portCount = 0;
+
+    // 输出端口: bit7 有数据, bit3 正在合并, bit1 LTP合并
+    for (uint8_t i = 0; i < routeCount; i++) {
+        ReplyPort& port = ports[portCount++];
+        port.address = routes[i].portAddress;
+        port.type = 0x80;
+        port.goodInput = 0;
+        port.goodOutputA = 0x80;
+        if (isMerging(i)) port.goodOutputA |= 0x08;
+        if (!config.mergeMode) port.goodOutputA |= 0x02;
+        // bit6 连续输出; 仅像素的端口或RDM关闭时不支持RDM(bit7)
+        port.goodOutputB = (routes[i].dmxMask && config.rdmEnabled) ? 0x40 : 0xC0;
+    }
+
+    // 输入端口: bit7 有数据, bit3 被禁用; 与输出同地址时合并为一个端口
+    for (uint8_t i = 0; i < ARTNET_MAX_INPUTS; i++) {
+        const InputPort& input = inputs[i];
+        if (!input.active) continue;
+
+        uint16_t address = ((input.packet[15] & 0x7F) << 8) | input.packet[14];
+        ReplyPort* port = nullptr;
+        for (uint8_t j = 0; j < portCount; j++) {
+            if (ports[j].address == address && !(ports[j].type & 0x40)) {
+                port = &ports[j];
+                break;
+            }
+        }
+        if (!port) {
+            port = &ports[portCount++];
+            port->address = address;
+            port->type = 0;
+            port->goodOutputA = 0;
+            port->goodOutputB = 0;
+        }
+        port->type |= 0x40;
+        port->goodInput = (input.length ? 0x80 : 0) | (input.disabled ? 0x08 : 0);
+    }
+
+    uint32_t assigned = 0;
+    replyPageCount = 0;
+    do {
+        uint8_t* reply = pollReplies[replyPageCount];
+        memset(reply, 0, ARTNET_POLL_REPLY_SIZE);
+
+        memcpy(reply, ARTNET_ID, 8);
+        reply[8] = OpPollReply & 0xFF;
+        reply[9] = (OpPollReply >> 8) & 0xFF;
+        memcpy(reply + 10, status.ip, 4);
+        reply[14] = ARTNET_PORT & 0xFF;          // 端口号低字节在前
+        reply[15] = (ARTNET_PORT >> 8) & 0xFF;
+        reply[16] = 0;                           // 固件版本
+        reply[17] = status.firmware;
+        reply[20] = (ARTNET_OEM >> 8) & 0xFF;
+        reply[21] = ARTNET_OEM & 0xFF;
+        reply[23] = status.status1;
+        reply[24] = ARTNET_ESTA_MAN & 0xFF;      // ESTA厂商码低字节在前
+        reply[25] = (ARTNET_ESTA_MAN >> 8) & 0xFF;
+        memcpy(reply + 26, config.shortName, 17);
+        memcpy(reply + 44, config.longName, 63);
+
+        // 取第一个未分配的端口确定本页的Net/SubNet, 再收集同组端口
+        uint8_t numPorts = 0;
+        for (uint8_t i = 0; i < portCount && numPorts < 4; i++) {
+            if (assigned & (1 << i)) continue;
+            uint16_t group = ports[i].address >> 4;
+            if (numPorts == 0) {
+                reply[18] = (group >> 4) & 0x7F;  // NetSwitch
+                reply[19] = group & 0x0F;         // SubSwitch
+            } else if (group != (uint16_t)((reply[18] << 4) | reply[19])) {
+                continue;
+            }
+            assigned |= 1 << i;
+            reply[174 + numPorts] = ports[i].type;
+            reply[178 + numPorts] = ports[i].goodInput;
+            reply[182 + numPorts] = ports[i].goodOutputA;
+            reply[186 + numPorts] = ports[i].address & 0x0F;  // SwIn
+            reply[190 + numPorts] = ports[i].address & 0x0F;  // SwOut
+            reply[213 + numPorts] = ports[i].goodOutputB;
+            numPorts++;
+        }
+        reply[172] = 0;
+        reply[173] = numPorts;
+
+        reply[200] = 0x00;                       // StNode
+        memcpy(reply + 201, status.mac, 6);
+        memcpy(reply + 207, status.ip, 4);       // BindIp: 根设备IP
+        reply[211] = replyPageCount + 1;         // BindIndex
+        reply[212] = status.status2;
+
+        replyPageCount++;
+    } while (assigned != (1UL << portCount) - 1 && replyPageCount < ARTNET_MAX_REPLY_PAGES);
+    if (assigned != (1UL << portCount) - 1) {
+        log_w("ArtPollReply pages exhausted, some ports not reported");
+    }
+
+    replySignature = pollReplySignature();
+    replyDirty = false;
+}
+
+// 包头预筛选: 只看ID、操作码和端口地址(前18字节)
+bool ArtnetNode::acceptHeader(const uint8_t* header, int length) {
+    if (length < 10 || memcmp(header, ARTNET_ID, 8) != 0) {
+        return false;
+    }
+
+    uint16_t opcode = header[8] | (header[9] << 8);
+    switch (opcode) {
+        case OpDmx:
+        case OpNzs: {
+            if (length < ART_DMX_HEADER_SIZE) {
+                return false;
+            }
+            // 非本节点宇宙: 路由表按端口地址散列, 无需遍历
+            uint16_t portAddress = ((header[15] & 0x7F) << 8) | header[14];
+            if (!findRoute(portAddress)) {
+                return false;
+            }
+            // 本节点广播的输入数据, 本地环回已在发送时完成
+            uint32_t localIp;
+            memcpy(&localIp, status.ip, 4);
+            return (uint32_t)udp.remoteIP() != localIp;
+        }
+        case OpPoll:
+        case OpSync:
+        case OpAddress:
+        case OpInput:
+        case OpRdm:
+        case OpTodRequest:
+        case OpTodControl:
+            return true;
+        default:
+            // 其他节点的ArtPollReply等不需要处理
+            return false;
+    }
 }
 
 bool ArtnetNode::validatePacket(uint8_t* data, uint16_t length) {
@@ -186,13 +555,163 @@ bool ArtnetNode::validatePacket(uint8_t* data, uint16_t length) {
 
 void ArtnetNode::setConfig(const Config& config) {
     this->config = config;
+    replyDirty = true;
+    rebuildRoutes();
     updateStatus();
 }
 
+// 网页等其他任务只提交配置, 路由表和合并缓冲只由网络任务修改
+void ArtnetNode::postConfig(const Config& config) {
+    portENTER_CRITICAL(&configLock);
+    pendingConfig = config;
+    configPending = true;
+    portEXIT_CRITICAL(&configLock);
+}
+
+void ArtnetNode::applyPendingConfig() {
+    if (!configPending) return;
+    Config next;
+    portENTER_CRITICAL(&configLock);
+    next = pendingConfig;
+    configPending = false;
+    portEXIT_CRITICAL(&configLock);
+    setConfig(next);
+}
+
+bool ArtnetNode::attachOutputs(ESP32DMX* dmxA, ESP32DMX* dmxB, PixelDriver* pixelDriver) {
+    dmxPorts[0] = dmxA;
+    dmxPorts[1] = dmxB;
+    pixels = pixelDriver;
+
+    // 控制器UID与RDM响应器一致: 制造商ID加MAC低4字节
+    WiFi.macAddress(nodeUid.id);
+    nodeUid.id[0] = 0x77;
+    nodeUid.id[1] = 0x77;
+    for (uint8_t port = 0; port < 2; port++) {
+        if (config.rdmEnabled && dmxPorts[port] && dmxPorts[port]->isRDMCapable()) {
+            discovery[port].begin(dmxPorts[port], &tods[port], nodeUid);
+        }
+    }
+
+    return rebuildRoutes();
+}
+
+void ArtnetNode::clearRoutes() {
+    releaseAllSources();
+    routeGeneration++;
+    replyDirty = true;
+    routeCount = 0;
+    pixelRouteMask = 0;
+    pixelPendingMask = 0;
+    pixelPendingTime = 0;
+    memset(routeIndex, ROUTE_NONE, sizeof(routeIndex));
+}
+
+bool ArtnetNode::addRoute(uint16_t portAddress, uint8_t dmxMask, uint8_t pixelSegment) {
+    portAddress &= 0x7FFF;
+    if (pixelSegment != ROUTE_NO_PIXEL && pixelSegment >= PIXEL_MAX_SEGMENTS) {
+        return false;
+    }
+
+    uint8_t hash = findRouteSlot(portAddress);
+    uint8_t slot = routeIndex[hash];
+    if (slot != ROUTE_NONE) {
+        Route& route = routes[slot];
+        if (pixelSegment != ROUTE_NO_PIXEL) {
+            if (route.pixelSegment != ROUTE_NO_PIXEL && route.pixelSegment != pixelSegment) {
+                log_e("Route %04X already drives pixel segment %u", portAddress, route.pixelSegment);
+                return false;
+            }
+            route.pixelSegment = pixelSegment;
+            pixelRouteMask |= (1 << pixelSegment);
+        }
+        route.dmxMask |= dmxMask;
+        return true;
+    }
+
+    if (routeCount >= ARTNET_MAX_ROUTES) {
+        log_e("Route table full, %04X dropped", portAddress);
+        return false;
+    }
+    routeGeneration++;
+
+    Route& route = routes[routeCount];
+    route.portAddress = portAddress;
+    route.dmxMask = dmxMask;
+    route.pixelSegment = pixelSegment;
+    if (pixelSegment != ROUTE_NO_PIXEL) {
+        pixelRouteMask |= (1 << pixelSegment);
+    }
+    routeIndex[hash] = routeCount++;
+    return true;
+}
+
+// 返回地址所在的槽, 不存在时返回探测到的第一个空槽
+uint8_t ArtnetNode::findRouteSlot(uint16_t portAddress) const {
+    uint8_t hash = (portAddress ^ (portAddress >> 6) ^ (portAddress >> 12)) & (ARTNET_ROUTE_SLOTS - 1);
+    while (routeIndex[hash] != ROUTE_NONE && routes[routeIndex[hash]].portAddress != portAddress) {
+        hash = (hash + 1) & (ARTNET_ROUTE_SLOTS - 1);
+    }
+    return hash;
+}
+
+// 按配置生成默认路由:
+// dmxMode 0: DMX A/B 同为基础宇宙; dmxMode 1: DMX B 使用下一个宇宙
+// 像素段紧接DMX宇宙之后, 每170像素占用一个宇宙; 指定了起始宇宙的输出从该端口地址开始
+bool ArtnetNode::rebuildRoutes() {
+    clearRoutes();
+
+    bool ok = true;
+    uint16_t base = makePortAddress(config.net, config.subnet, config.universe);
+    // 配置为输入的端口不接收Art-Net输出
+    if (!(dmxPorts[0] && dmxPorts[0]->isInput())) {
+        ok &= addRoute(base, ROUTE_OUT_DMX_A);
+    }
+    if (!(dmxPorts[1] && dmxPorts[1]->isInput())) {
+        ok &= addRoute(config.dmxMode ? base + 1 : base, ROUTE_OUT_DMX_B);
+    }
+
+    // DMX输入端口以对应的宇宙发出
+    uint16_t inputAddress[2] = {base, (uint16_t)(config.dmxMode ? base + 1 : base)};
+    for (uint8_t port = 0; port < 2; port++) {
+        if (dmxPorts[port] && dmxPorts[port]->isInput()) {
+            setInput(port, inputAddress[port], dmxPorts[port]);
+        } else if (inputs[port].source) {
+            clearInput(port);
+        }
+    }
+
+    // 每路像素输出占用连续的宇宙, 未指定起始宇宙时接在前一路之后
+    if (!pixels) return ok;
+    uint16_t pixelBase = base + (config.dmxMode ? 2 : 1);
+    uint8_t segment = 0;
+    for (uint8_t i = 0; i < pixels->getOutputCount(); i++) {
+        const PixelOutput& output = pixels->getOutput(i);
+        if (output.universe != PIXEL_UNIVERSE_AUTO) {
+            pixelBase = output.universe;
+        }
+        for (uint8_t k = 0; k < output.segments; k++) {
+            ok &= addRoute(pixelBase++, 0, segment++);
+        }
+    }
+    return ok;
+}
+
+const ArtnetNode::Route* ArtnetNode::findRoute(uint16_t portAddress) const {
+    uint8_t slot = routeIndex[findRouteSlot(portAddress & 0x7FFF)];
+    if (slot == ROUTE_NONE) {
+        return nullptr;
+    }
+    return &routes[slot];
+}
+
 void ArtnetNode::updateStatus() {
     status.goodInput = 0x80;  // 数据是好的
     status.goodOutput = 0x80; // 输出是好的
-    status.status1 = 0x80;    // 显示正常运行
+    status.status1 = 0xE2;    // 指示灯正常, 端口地址由网络/网页设置, 支持RDM
+    // 支持网页配置, DHCP可用, 支持15位端口地址
+    status.status2 = 0x0D | (status.dhcp ? 0x02 : 0x00);
+    replyDirty = true;
 }
 
 // 回调设置方法
@@ -200,7 +719,7 @@ void ArtnetNode::setDMXCallback(void (*callback)(uint16_t, uint8_t*, uint16_t))
     dmxCallback = callback;
 }
 
-void ArtnetNode::setRDMCallback(void (*callback)(uint8_t*, uint16_t)) {
+void ArtnetNode::setRDMCallback(uint16_t (*callback)(const uint8_t*, uint16_t, const uint8_t**)) {
     rdmCallback = callback;
 }
 
@@ -208,23 +727,240 @@ void ArtnetNode::setPixelCallback(void (*callback)(uint8_t*, uint16_t)) {
     pixelCallback = callback;
 }
 
-void ArtnetNode::handleArtRdm(uint8_t* data, uint16_t size) {
-    // 处理 Art-Net RDM 包
-    if (!data || size < ART_RDM_MIN_SIZE) {
+// ArtRdm: 补上起始码后排入对应DMX端口的RDM事务队列, 应答在 serviceRdm 中回送
+void ArtnetNode::handleArtRdm(uint8_t* data, uint16_t size, uint32_t sourceIp) {
+    if (!config.rdmEnabled || !data || size < ART_RDM_MIN_SIZE) {
+        return;
+    }
+
+    // RdmVer 必须为1, Command 只支持 ArProcess(0)
+    if (data[12] != 0x01 || data[22] != 0x00) {
+        return;
+    }
+    uint16_t portAddress = ((data[21] & 0x7F) << 8) | data[23];
+    const Route* route = findRoute(portAddress);
+    if (!route || !route->dmxMask) {
+        return;
+    }
+
+    // data[24] 起为不含起始码的RDM消息, 消息长度字段包含起始码
+    uint8_t request[RDM_MAX_PACKET];
+    request[0] = 0xCC;
+    uint16_t length = size - 24 + 1;
+    if (length > RDM_MAX_PACKET) {
+        length = RDM_MAX_PACKET;
+    }
+    memcpy(request + 1, data + 24, length - 1);
+
+    // 截断、长度字段异常或校验和错误的请求直接丢弃, 多余的尾部字节不转发
+    if (!rdmValidate(request, length)) {
+        return;
+    }
+    length = request[RDM_OFFSET_LENGTH] + 2;
+
+    // 发给本机的请求由响应器直接应答, 不转发到DMX线路
+    if (rdmCallback) {
+        const uint8_t* response = nullptr;
+        uint16_t responseLength = rdmCallback(request, length, &response);
+        if (responseLength && response) {
+            sendArtRdm(portAddress, response, responseLength, sourceIp);
+            return;
+        }
+    }
+
+    for (uint8_t port = 0; port < 2; port++) {
+        if ((route->dmxMask & (1 << port)) && dmxPorts[port] && dmxPorts[port]->isRDMCapable()) {
+            dmxPorts[port]->queueRDM(request, length, sourceIp);
+        }
+    }
+}
+
+// ArtTodRequest: 直接以缓存的设备表应答
+void ArtnetNode::handleArtTodRequest(uint8_t* data, uint16_t size, uint32_t sourceIp) {
+    if (!config.rdmEnabled || !data || size < ART_TOD_MIN_SIZE) {
+        return;
+    }
+
+    uint8_t net = data[21] & 0x7F;
+    uint8_t count = data[23];
+    if (count > 32) count = 32;
+    if (count > size - ART_TOD_MIN_SIZE) count = size - ART_TOD_MIN_SIZE;
+
+    for (uint8_t i = 0; i < count; i++) {
+        uint16_t portAddress = (net << 8) | data[24 + i];
+        const Route* route = findRoute(portAddress);
+        if (!route) continue;
+        for (uint8_t port = 0; port < 2; port++) {
+            if ((route->dmxMask & (1 << port)) && dmxPorts[port] && dmxPorts[port]->isRDMCapable()) {
+                sendTodData(port, portAddress, sourceIp);
+            }
+        }
+    }
+}
+
+// ArtTodControl: AtcFlush 清空设备表并重新完整发现, AtcEnd 停止发现,
+// AtcIncOn/AtcIncOff 开关后台增量发现
+void ArtnetNode::handleArtTodControl(uint8_t* data, uint16_t size, uint32_t sourceIp) {
+    if (!config.rdmEnabled || !data || size < ART_TOD_MIN_SIZE) {
+        return;
+    }
+
+    uint16_t portAddress = ((data[21] & 0x7F) << 8) | data[23];
+    uint8_t command = data[22];
+    const Route* route = findRoute(portAddress);
+    if (!route) {
         return;
     }
 
-    // 解析 RDM 数据
-    uint8_t sequenceNumber = data[12];
-    uint8_t portAddress = data[13];
-    uint8_t* rdmData = &data[14];
-    uint16_t rdmDataLength = size - 14;
+    for (uint8_t port = 0; port < 2; port++) {
+        if (!(route->dmxMask & (1 << port)) || !dmxPorts[port] || !dmxPorts[port]->isRDMCapable()) {
+            continue;
+        }
+        switch (command) {
+            case 0x01:  // AtcFlush
+                discovery[port].start(true);
+                break;
+            case 0x02:  // AtcEnd
+                discovery[port].stop();
+                break;
+            case 0x03:  // AtcIncOn
+                discovery[port].setIncremental(true);
+                break;
+            case 0x04:  // AtcIncOff
+                discovery[port].setIncremental(false);
+                break;
+        }
+        sendTodData(port, portAddress, sourceIp);
+    }
+}
+
+// 发送端口的设备表, 超过200个UID时分块发送; 有本机响应器时本机UID列在首位
+void ArtnetNode::sendTodData(uint8_t port, uint16_t portAddress, uint32_t ip) {
+    const RDMTod& tod = tods[port];
+    uint16_t self = rdmCallback ? 1 : 0;
+    uint16_t total = tod.count() + self;
+    uint8_t packet[28 + ART_TOD_MAX_UIDS * RDM_UID_LENGTH];
+    memset(packet, 0, 28);
+
+    memcpy(packet, ARTNET_ID, 8);
+    packet[8] = OpTodData & 0xFF;
+    packet[9] = (OpTodData >> 8) & 0xFF;
+    packet[11] = ARTNET_VERSION;
+    packet[12] = 0x01;                      // RdmVer
+    packet[13] = port + 1;                  // 物理端口, 从1开始
+    packet[20] = findBindIndex(portAddress);
+    packet[21] = (portAddress >> 8) & 0x7F;
+    packet[22] = 0x00;                      // TodFull
+    packet[23] = portAddress & 0xFF;
+    packet[24] = total >> 8;
+    packet[25] = total & 0xFF;
+
+    uint16_t sent = 0;
+    uint8_t block = 0;
+    do {
+        uint16_t count = total - sent;
+        if (count > ART_TOD_MAX_UIDS) count = ART_TOD_MAX_UIDS;
+        packet[26] = block++;
+        packet[27] = count;
+        for (uint16_t i = 0; i < count; i++) {
+            uint16_t index = sent + i;
+            const RDMUID& uid = index < self ? nodeUid : tod.get(index - self);
+            memcpy(packet + 28 + i * RDM_UID_LENGTH, uid.id, RDM_UID_LENGTH);
+        }
+        sent += count;
+
+        udp.beginPacket(IPAddress(ip), ARTNET_PORT);
+        udp.write(packet, 28 + count * RDM_UID_LENGTH);
+        udp.endPacket();
+    } while (sent < total);
+}
+
+// 取回RDM事务结果: 发现事务交给发现引擎, 其余有效应答回送给请求方,
+// 应答方UID加入设备表. 设备表变化时主动广播 ArtTodData
+void ArtnetNode::serviceRdm() {
+    if (!config.rdmEnabled) return;
+    for (uint8_t port = 0; port < 2; port++) {
+        if (!dmxPorts[port]) continue;
+
+        while (dmxPorts[port]->readRDMResult(rdmResult)) {
+            if (rdmResult.tag == RDM_TAG_DISCOVERY) {
+                discovery[port].handleResult(rdmResult);
+                continue;
+            }
+
+            const uint8_t* response = rdmResult.data;
+            if (rdmResult.status != RDM_STATUS_OK || !rdmValidate(response, rdmResult.length)) {
+                continue;
+            }
+            uint16_t messageLength = response[RDM_OFFSET_LENGTH];
+
+            tods[port].add(&response[9]);
+
+            uint16_t portAddress;
+            if (rdmPortAddress(port, portAddress)) {
+                sendArtRdm(portAddress, response, messageLength + 2, rdmResult.tag);
+            }
+        }
+
+        discovery[port].update();
+
+        uint16_t portAddress;
+        if (!discovery[port].isRunning() && discovery[port].takeChanged() &&
+            rdmPortAddress(port, portAddress)) {
+            sendTodData(port, portAddress, broadcastIp);
+        }
+    }
+}
+
+// ArtRdm 应答: 负载为不含起始码的RDM消息
+void ArtnetNode::sendArtRdm(uint16_t portAddress, const uint8_t* packet, uint16_t length, uint32_t ip) {
+    uint8_t reply[24 + RDM_MAX_PACKET];
+    memset(reply, 0, 24);
+
+    memcpy(reply, ARTNET_ID, 8);
+    reply[8] = OpRdm & 0xFF;
+    reply[9] = (OpRdm >> 8) & 0xFF;
+    reply[11] = ARTNET_VERSION;
+    reply[12] = 0x01;                       // RdmVer
+    reply[21] = (portAddress >> 8) & 0x7F;
+    reply[22] = 0x00;                       // ArProcess
+    reply[23] = portAddress & 0xFF;
+    memcpy(reply + 24, packet + 1, length - 1);
+
+    udp.beginPacket(IPAddress(ip), ARTNET_PORT);
+    udp.write(reply, 24 + length - 1);
+    udp.endPacket();
+}
+
+// 端口输出的宇宙(第一个包含该端口的路由)
+bool ArtnetNode::rdmPortAddress(uint8_t port, uint16_t& portAddress) const {
+    for (uint8_t i = 0; i < routeCount; i++) {
+        if (routes[i].dmxMask & (1 << port)) {
+            portAddress = routes[i].portAddress;
+            return true;
+        }
+    }
+    return false;
+}
 
-    // TODO: 实现 RDM 处理逻辑
-    // 这里添加您的 RDM 处理代码
+// 在ArtPollReply缓存中查找输出该宇宙的页
+uint8_t ArtnetNode::findBindIndex(uint16_t portAddress) {
+    if (replyDirty) {
+        buildPollReplies();
+    }
+    for (uint8_t page = 0; page < replyPageCount; page++) {
+        const uint8_t* reply = pollReplies[page];
+        uint16_t group = (reply[18] << 8) | (reply[19] << 4);
+        for (uint8_t i = 0; i < reply[173]; i++) {
+            if ((reply[174 + i] & 0x80) && (group | reply[190 + i]) == portAddress) {
+                return page + 1;
+            }
+        }
+    }
+    return 1;
 }
 
-void ArtnetNode::handleArtAddress(uint8_t* data, uint16_t size) {
+void ArtnetNode::handleArtAddress(uint8_t* data, uint16_t size, uint32_t sourceIp) {
     // 处理 Art-Net Address 包
     if (!data || size < ART_ADDRESS_MIN_SIZE) {
         return;
@@ -246,28 +982,376 @@ void ArtnetNode::handleArtAddress(uint8_t* data, uint16_t size) {
     if (universe != 0x7f) {
         config.universe = universe;
     }
+    rebuildRoutes();
+    schedulePollReply(sourceIp);
 
     // TODO: 处理其他地址配置
     // 这里添加额外的地址处理代码
 }
 
-void ArtnetNode::handleArtSync() {
-    // 处理 Art-Net Sync 包
-    // 通常用于同步多个节点的输出
+void ArtnetNode::handleArtSync(uint32_t sourceIp) {
+    // 按规范只接受发送ArtDmx的控制器的ArtSync, 其他主机或广播的一律忽略
+    if (!syncSourceIp || sourceIp != syncSourceIp) {
+        return;
+    }
+
+    // 合并期间按规范忽略ArtSync
+    for (uint8_t i = 0; i < routeCount; i++) {
+        if (isMerging(i)) {
+            return;
+        }
+    }
+
+    // 进入同步模式, 一次性提交所有宇宙的暂存帧
+    syncMode = true;
+    lastSyncTime = millis();
+    updateDmxOutput();
+}
+
+// 提交暂存的DMX帧并刷新像素
+void ArtnetNode::updateDmxOutput() {
+    for (uint8_t port = 0; port < 2; port++) {
+        if (dmxPorts[port]) {
+            dmxPorts[port]->commitFrame();
+        }
+    }
 
-    // 设置同步标志
-    syncReceived = true;
+    if (pixels && pixelPendingMask) {
+        showPixels();
+    }
+}
+
+void ArtnetNode::showPixels() {
+    pixelPendingMask = 0;
+    pixels->show();
+}
 
-    // 如果启用了同步模式，则在收到同步包时更新输出
-    if (syncMode) {
-        // 更新 DMX 输出
+// 部分像素段迟迟未到时按超时刷新, 同步模式由ArtSync负责
+void ArtnetNode::checkPixelTimeout() {
+    if (!syncMode && pixelPendingMask && millis() - pixelPendingTime >= ARTNET_PIXEL_TIMEOUT) {
+        showPixels();
+    }
+}
+
+// DHCP续租或重连其他AP后IP/子网可能变化, 刷新本机地址和广播地址并重建ArtPollReply
+void ArtnetNode::checkNetworkAddress() {
+    uint32_t ip = WiFi.localIP();
+    uint32_t mask = WiFi.subnetMask();
+    // 定向广播地址, 无控制器时输入数据发往这里
+    uint32_t broadcast = (ip && mask) ? (ip | ~mask) : 0xFFFFFFFF;
+    if (memcmp(status.ip, &ip, 4) == 0 && broadcast == broadcastIp) {
+        return;
+    }
+    memcpy(status.ip, &ip, 4);
+    broadcastIp = broadcast;
+    replyDirty = true;
+}
+
+// 超过4秒未收到ArtSync则回到立即输出
+void ArtnetNode::checkSyncTimeout() {
+    if (syncMode && millis() - lastSyncTime > ARTNET_SYNC_TIMEOUT) {
+        syncMode = false;
         updateDmxOutput();
     }
 }
 
-void ArtnetNode::updateDmxOutput() {
-    // 实际的 DMX 输出更新逻辑
-    // 这个方法应该在您的代码中已经实现
+// 解析合并: 单源直接透传, LTP取最新帧, HTP逐通道取最大值
+// 返回 nullptr 表示该包来自第三个源或序号过期, 应忽略
+uint8_t* ArtnetNode::mergeFrame(uint8_t routeIndex, uint32_t sourceIp, uint8_t* payload, uint16_t& length,
+                                uint8_t sequence) {
+    MergeSource* slots = sources[routeIndex];
+    MergeSource* self = nullptr;
+    MergeSource* freeSlot = nullptr;
+    uint8_t active = 0;
+    uint32_t now = millis();
+
+    for (uint8_t i = 0; i < ARTNET_MAX_SOURCES; i++) {
+        MergeSource& source = slots[i];
+        if (source.ip && now - source.lastSeen > ARTNET_MERGE_TIMEOUT) {
+            releaseSource(source, true);
+        }
+        if (!source.ip) {
+            if (!freeSlot) freeSlot = &source;
+            continue;
+        }
+        if (source.ip == sourceIp) {
+            self = &source;
+        }
+        active++;
+    }
+
+    if (!self) {
+        if (!freeSlot) {
+            return nullptr;
+        }
+        self = freeSlot;
+        self->ip = sourceIp;
+        self->sequence = 0;
+        active++;
+    }
+    if (!acceptSequence(*self, sequence)) {
+        return nullptr;
+    }
+    self->lastSeen = now;
+
+    // 单一源或LTP: 最新帧即输出, 无需额外拷贝
+    if (active < ARTNET_MAX_SOURCES || !config.mergeMode) {
+        if (active < ARTNET_MAX_SOURCES) {
+            releaseSource(*self, false);
+        }
+        return payload;
+    }
+
+    // HTP: 另一个源尚无快照时, 以当前DMX输出作为其最后一帧
+    MergeSource& other = (self == &slots[0]) ? slots[1] : slots[0];
+    if (!other.data) {
+        const Route& route = routes[routeIndex];
+        uint8_t port = (route.dmxMask & ROUTE_OUT_DMX_A) ? 0 : 1;
+        if (route.dmxMask && dmxPorts[port]) {
+            storeSource(other, dmxPorts[port]->getDMXData(), ARTNET_DMX_LENGTH);
+        } else {
+            storeSource(other, nullptr, 0);
+        }
+    }
+    if (!storeSource(*self, payload, length) || !other.data) {
+        return payload;
+    }
+
+    uint16_t mergedLength = self->length > other.length ? self->length : other.length;
+    const uint32_t* a = (const uint32_t*)slots[0].data;
+    const uint32_t* b = (const uint32_t*)slots[1].data;
+    uint16_t words = (mergedLength + 3) / 4;
+    for (uint16_t i = 0; i < words; i++) {
+        mergeOutput[i] = maxBytes4(a[i], b[i]);
+    }
+
+    length = mergedLength;
+    return (uint8_t*)mergeOutput;
+}
+
+// 按源检查序号: 序号在1~255循环, 0 表示发送端不使用序号
+bool ArtnetNode::acceptSequence(MergeSource& source, uint8_t sequence) {
+    if (sequence == 0 || source.sequence == 0) {
+        source.sequence = sequence;
+        return true;
+    }
+
+    int16_t diff = (int16_t)sequence - source.sequence;
+    if (diff > 127) {
+        diff -= 255;
+    } else if (diff < -127) {
+        diff += 255;
+    }
+
+    if (diff == 0) {
+        stats.framesDuplicate++;
+        gMetrics.countDropped();
+        return false;
+    }
+    if (diff < 0 && diff > -ARTNET_SEQ_WINDOW) {
+        stats.framesReordered++;
+        gMetrics.countDropped();
+        return false;
+    }
+    if (diff > 1) {
+        stats.framesLost += diff - 1;
+    }
+
+    source.sequence = sequence;
+    return true;
+}
+
+// 保存源的最后一帧, 缺失的通道按0处理
+bool ArtnetNode::storeSource(MergeSource& source, const uint8_t* payload, uint16_t length) {
+    if (!source.data) {
+        source.data = (uint8_t*)malloc(ARTNET_DMX_LENGTH);
+        if (!source.data) {
+            return false;
+        }
+    }
+    if (payload && length) {
+        memcpy(source.data, payload, length);
+    }
+    memset(source.data + length, 0, ARTNET_DMX_LENGTH - length);
+    source.length = length;
+    return true;
+}
+
+void ArtnetNode::releaseSource(MergeSource& source, bool forget) {
+    if (source.data) {
+        free(source.data);
+        source.data = nullptr;
+    }
+    source.length = 0;
+    if (forget) {
+        source.ip = 0;
+        source.sequence = 0;
+    }
+}
+
+void ArtnetNode::releaseMergeSource(uint8_t routeIndex, uint32_t sourceIp) {
+    if (routeIndex >= routeCount || !sourceIp) return;
+    for (uint8_t i = 0; i < ARTNET_MAX_SOURCES; i++) {
+        if (sources[routeIndex][i].ip == sourceIp) {
+            releaseSource(sources[routeIndex][i], true);
+        }
+    }
+}
+
+void ArtnetNode::releaseAllSources() {
+    for (uint8_t r = 0; r < ARTNET_MAX_ROUTES; r++) {
+        for (uint8_t i = 0; i < ARTNET_MAX_SOURCES; i++) {
+            releaseSource(sources[r][i], true);
+        }
+    }
+}
+
+bool ArtnetNode::isMerging(uint8_t routeIndex) const {
+    uint32_t now = millis();
+    uint8_t active = 0;
+    for (uint8_t i = 0; i < ARTNET_MAX_SOURCES; i++) {
+        const MergeSource& source = sources[routeIndex][i];
+        if (source.ip && now - source.lastSeen <= ARTNET_MERGE_TIMEOUT) {
+            active++;
+        }
+    }
+    return active >= ARTNET_MAX_SOURCES;
+}
+
+// 配置输入端口并预填ArtDmx包头
+bool ArtnetNode::setInput(uint8_t index, uint16_t portAddress, ESP32DMX* source) {
+    if (index >= ARTNET_MAX_INPUTS) {
+        return false;
+    }
+
+    InputPort& input = inputs[index];
+    bool disabled = input.disabled;
+    memset(&input, 0, sizeof(InputPort));
+    input.active = true;
+    input.disabled = disabled;
+    input.source = source;
+
+    uint8_t* header = input.packet;
+    memcpy(header, ARTNET_ID, 8);
+    header[8] = OpDmx & 0xFF;
+    header[9] = (OpDmx >> 8) & 0xFF;
+    header[10] = 0;
+    header[11] = ARTNET_VERSION;
+    header[12] = 0;                        // 序号, 发送时填写
+    header[13] = index;                    // 物理端口
+    header[14] = portAddress & 0xFF;       // SubUni
+    header[15] = (portAddress >> 8) & 0x7F; // Net
+
+    replyDirty = true;
+    return true;
+}
+
+void ArtnetNode::clearInput(uint8_t index) {
+    if (index >= ARTNET_MAX_INPUTS) {
+        return;
+    }
+    memset(&inputs[index], 0, sizeof(InputPort));
+    replyDirty = true;
+}
+
+// 数据有变化时立即发送, 否则留给保活重发
+bool ArtnetNode::sendInput(uint8_t index, const uint8_t* data, uint16_t length) {
+    if (!isInputEnabled(index)) {
+        return false;
+    }
+
+    InputPort& input = inputs[index];
+    if (length > ARTNET_DMX_LENGTH) {
+        length = ARTNET_DMX_LENGTH;
+    }
+    // ArtDmx长度须为2~512的偶数, 不足部分补0
+    uint16_t padded = (length + 1) & ~1;
+    if (padded < 2) {
+        padded = 2;
+    }
+
+    uint8_t* payload = input.packet + 18;
+    if (padded == input.length && memcmp(payload, data, length) == 0) {
+        return false;
+    }
+
+    memcpy(payload, data, length);
+    memset(payload + length, 0, padded - length);
+    if (padded != input.length) {
+        input.length = padded;
+        input.packet[16] = padded >> 8;
+        input.packet[17] = padded & 0xFF;
+    }
+    transmitInput(input);
+
+    // 本节点也路由了该宇宙时, 作为一个源送入合并引擎
+    uint16_t portAddress = ((input.packet[15] & 0x7F) << 8) | input.packet[14];
+    const Route* route = findRoute(portAddress);
+    if (route) {
+        uint32_t localIp;
+        memcpy(&localIp, status.ip, 4);
+        outputFrame(route, localIp, payload, padded);
+    }
+    return true;
+}
+
+// 单播给在线的控制器, 没有控制器时广播
+void ArtnetNode::transmitInput(InputPort& input) {
+    uint8_t sequence = input.packet[12] + 1;
+    input.packet[12] = sequence ? sequence : 1;  // 0 表示不使用序号
+    input.lastSend = millis();
+
+    uint32_t targets[ARTNET_MAX_CONTROLLERS];
+    uint8_t count = getActiveControllers(targets);
+    if (count == 0) {
+        targets[0] = broadcastIp;
+        count = 1;
+    }
+
+    uint16_t size = 18 + input.length;
+    for (uint8_t i = 0; i < count; i++) {
+        udp.beginPacket(IPAddress(targets[i]), ARTNET_PORT);
+        udp.write(input.packet, size);
+        udp.endPacket();
+    }
+}
+
+uint8_t ArtnetNode::getActiveControllers(uint32_t* ips) const {
+    uint32_t now = millis();
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < ARTNET_MAX_CONTROLLERS; i++) {
+        const Controller& controller = controllers[i];
+        if (controller.ip && now - controller.lastSeen <= ARTNET_CONTROLLER_TIMEOUT) {
+            ips[count++] = controller.ip;
+        }
+    }
+    return count;
+}
+
+// 转发新到的DMX输入帧, 并对不变的数据做保活重发
+void ArtnetNode::serviceInputs() {
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < ARTNET_MAX_INPUTS; i++) {
+        InputPort& input = inputs[i];
+        if (!input.active || input.disabled) continue;
+
+        if (input.source) {
+            const uint8_t* frame;
+            uint16_t slots;
+            uint32_t seq = input.source->readInputFrame(frame, slots);
+            // 只转发起始码为0的标准DMX帧
+            if (seq != input.frameSeq && slots > 0 && frame[0] == 0) {
+                input.frameSeq = seq;
+                if (sendInput(i, frame + 1, slots)) {
+                    continue;
+                }
+            }
+        }
+
+        if (input.length && now - input.lastSend >= ARTNET_INPUT_KEEPALIVE) {
+            transmitInput(input);
+        }
+    }
 }
 
 // 如果需要，添加其他辅助方法
@@ -7,17 +7,60 @@
 #include "dmx/ESP32DMX.h"
 #include "pixels/PixelDriver.h"
 #include "rdm/RDMHandler.h"
+#include "rdm/RDMTod.h"
+#include "rdm/RDMDiscovery.h"
 
 // Art-Net 包大小常量定义
 #define ART_NET_MIN_SIZE 12
-#define ART_RDM_MIN_SIZE 14
+#define ART_RDM_MIN_SIZE 49         // 24字节包头 + 最短RDM消息(不含起始码)
+#define ART_TOD_MIN_SIZE 24
+#define ART_TOD_MAX_UIDS 200        // 每个ArtTodData包最多携带的UID数
 #define ART_ADDRESS_MIN_SIZE 16
+#define ART_DMX_HEADER_SIZE 18
 
 // Art-Net 协议常量
 #define ARTNET_PORT 6454
 #define ARTNET_DMX_LENGTH 512
 #define ARTNET_VERSION 14
 
+// 路由表常量
+#define ARTNET_MAX_ROUTES (2 + PIXEL_MAX_SEGMENTS)  // DMX A/B + 像素段
+#define ARTNET_ROUTE_SLOTS 64                       // 路由散列表槽数, 2的幂且至少为路由数的两倍
+#define ROUTE_OUT_DMX_A 0x01
+#define ROUTE_OUT_DMX_B 0x02
+#define ROUTE_NO_PIXEL 0xFF
+#define ROUTE_NONE 0xFF
+
+// ArtSync 超时(ms), 超时后回到立即输出
+#define ARTNET_SYNC_TIMEOUT 4000
+
+// 像素段未到齐时的刷新超时(ms), 控制器少发宇宙或丢包时不冻结灯带
+#define ARTNET_PIXEL_TIMEOUT 25
+
+// 合并常量
+#define ARTNET_MAX_SOURCES 2           // 每个宇宙最多合并的源数
+#define ARTNET_MERGE_TIMEOUT 10000     // 合并源超时(ms), 规范规定10秒
+#define ARTNET_SEQ_WINDOW 20           // 落后超过该值视为发送端重启, 重新同步序号
+
+// 输入(发送)常量
+#define ARTNET_MAX_INPUTS 2            // 输入端口数, 与DMX A/B对应
+#define ARTNET_INPUT_KEEPALIVE 1000    // 数据不变时的重发间隔(ms)
+#define ARTNET_MAX_CONTROLLERS 4       // 记录的控制器(ArtPoll发送方)数
+#define ARTNET_CONTROLLER_TIMEOUT 10000
+#define ART_INPUT_MIN_SIZE 20
+
+// ArtPollReply 常量
+#define ARTNET_POLL_REPLY_SIZE 239
+#define ARTNET_MAX_REPLY_PORTS (ARTNET_MAX_ROUTES + ARTNET_MAX_INPUTS)
+// 每页最多4个同一Net/SubNet组的端口. 端口地址来自DMX/自动像素区段和各路指定了起始宇宙的像素区段,
+// 每个区段最多多出一个不满的页
+#define ARTNET_MAX_REPLY_PAGES ((ARTNET_MAX_REPLY_PORTS + 3) / 4 + PIXEL_MAX_OUTPUTS)
+#define ARTNET_POLL_REPLY_JITTER 250     // 回复随机延迟上限(ms)
+#define ARTNET_POLL_REPLY_INTERVAL 1000  // 两次回复的最小间隔(ms)
+#define ARTNET_POLL_UNICAST_MAX 2        // 请求方超过该数量时改为广播回复
+#define ARTNET_OEM 0x00FF                // OemUnknown
+#define ARTNET_ESTA_MAN 0x7FF0           // ESTA原型厂商码
+
 // Art-Net包类型
 enum ArtNetOpCodes {
     OpPoll = 0x2000,
@@ -27,7 +70,10 @@ enum ArtNetOpCodes {
     OpSync = 0x5200,
     OpAddress = 0x6000,
     OpInput = 0x7000,
-    OpRdm = 0x8400,
+    OpTodRequest = 0x8000,
+    OpTodData = 0x8100,
+    OpTodControl = 0x8200,
+    OpRdm = 0x8300,
     OpIpProg = 0xF800,
     OpIpProgReply = 0xF900
 };
@@ -46,6 +92,25 @@ public:
         uint16_t pixelCount;
         uint8_t pixelType;
         bool mergeMode;  // HTP = true, LTP = false
+        bool rdmEnabled; // false 时不发现设备, 不转发ArtRdm, 不应答TOD请求
+    };
+
+    // 路由表项: 一个15位端口地址对应的全部输出
+    struct Route {
+        uint16_t portAddress;   // Net(7) : SubNet(4) : Universe(4)
+        uint8_t dmxMask;        // ROUTE_OUT_DMX_A / ROUTE_OUT_DMX_B
+        uint8_t pixelSegment;   // 像素段号, ROUTE_NO_PIXEL 表示无
+    };
+
+    // 收包统计
+    struct Stats {
+        uint32_t packetsProcessed;  // 已处理的Art-Net包
+        uint32_t packetsDropped;    // 超长或读取失败而丢弃的包
+        uint32_t packetsFiltered;   // 包头预筛选丢弃的包(非Art-Net/非本节点宇宙)
+        uint32_t budgetExhausted;   // 预算用尽时结束收包的次数
+        uint32_t framesReordered;   // 序号落后而丢弃的帧
+        uint32_t framesDuplicate;   // 序号重复而丢弃的帧
+        uint32_t framesLost;        // 序号跳跃推算出的丢失帧
     };
 
     // 节点状态结构体
@@ -55,7 +120,6 @@ public:
         bool dhcp;
         uint8_t firmware;
         uint8_t ports;
-        uint8_t portTypes[4];
         uint8_t goodInput;
         uint8_t goodOutput;
         uint8_t status1;
@@ -72,10 +136,48 @@ public:
     bool begin();
     void update();
 
-    // 配置方法
+    // 配置方法: setConfig 只能在网络任务(或任务启动前)调用,
+    // 其他任务用 postConfig 提交, 下次 update() 时生效
     void setConfig(const Config& config);
+    void postConfig(const Config& config);
     const Config& getConfig() const { return config; }
     const Status& getStatus() const { return status; }
+    const Stats& getStats() const { return stats; }
+    void setReceiveBudget(uint8_t budget) { receiveBudget = budget ? budget : 1; }
+
+    // 输出绑定与路由: 路由冲突(同一地址两个像素段)或路由表满时返回 false
+    bool attachOutputs(ESP32DMX* dmxA, ESP32DMX* dmxB, PixelDriver* pixelDriver);
+    bool addRoute(uint16_t portAddress, uint8_t dmxMask, uint8_t pixelSegment = ROUTE_NO_PIXEL);
+    void clearRoutes();
+    bool rebuildRoutes();
+    const Route* findRoute(uint16_t portAddress) const;
+    uint32_t getRouteGeneration() const { return routeGeneration; }  // 路由表每次变化加1
+    uint8_t getRouteCount() const { return routeCount; }
+    const Route& getRoute(uint8_t index) const { return routes[index]; }
+    bool isMerging(uint8_t routeIndex) const;
+    static uint16_t makePortAddress(uint8_t net, uint8_t subnet, uint8_t universe) {
+        return ((net & 0x7F) << 8) | ((subnet & 0x0F) << 4) | (universe & 0x0F);
+    }
+
+    // 输入端口: 本地数据以ArtDmx发出, source 为 nullptr 时由 sendInput 提供数据
+    bool setInput(uint8_t index, uint16_t portAddress, ESP32DMX* source = nullptr);
+    void clearInput(uint8_t index);
+    bool sendInput(uint8_t index, const uint8_t* data, uint16_t length);
+    bool isInputEnabled(uint8_t index) const {
+        return index < ARTNET_MAX_INPUTS && inputs[index].active && !inputs[index].disabled;
+    }
+
+    // 把一帧送往路由的全部输出, Art-Net/sACN/本地输入共用
+    // sourceIp 为合并引擎中的源标识: Art-Net为发送方IP, sACN为CID散列
+    // sequence 为0表示不做序号检查
+    void outputFrame(const Route* route, uint32_t sourceIp, uint8_t* payload, uint16_t length,
+                     uint8_t sequence = 0);
+    // 立即把源移出合并(sACN源失去优先级或终止), 不等 ARTNET_MERGE_TIMEOUT
+    void releaseMergeSource(uint8_t routeIndex, uint32_t sourceIp);
+
+    // RDM: 每个DMX端口一张设备表, 应答ArtTodRequest时直接使用
+    RDMTod& getTod(uint8_t port) { return tods[port]; }
+    RDMDiscovery& getDiscovery(uint8_t port) { return discovery[port]; }
 
     // DMX输出控制
     void setDMXOutput(uint8_t* data, uint16_t length);
@@ -83,7 +185,8 @@ public:
 
     // 回调函数设置
     void setDMXCallback(void (*callback)(uint16_t universe, uint8_t* data, uint16_t length));
-    void setRDMCallback(void (*callback)(uint8_t* data, uint16_t length));
+    // 本机RDM响应器: 返回应答长度(0为非本机请求), 应答经 response 返回
+    void setRDMCallback(uint16_t (*callback)(const uint8_t* request, uint16_t length, const uint8_t** response));
     void setPixelCallback(void (*callback)(uint8_t* data, uint16_t length));
 
 protected:
@@ -92,36 +195,128 @@ protected:
 private:
     // 成员变量
     Config config;
+    Config pendingConfig;        // postConfig 提交, 等待网络任务应用
+    volatile bool configPending;
+    portMUX_TYPE configLock;
     Status status;
+    Stats stats;
+    uint8_t receiveBudget;
     WiFiUDP udp;
-    ESP32DMX* dmx;
+    ESP32DMX* dmxPorts[2];
     PixelDriver* pixels;
-    bool syncMode;
-    bool syncReceived;
+    bool syncMode;           // 收到ArtSync后进入同步输出
+    uint32_t lastSyncTime;
+    uint32_t syncSourceIp;   // 最近ArtDmx的发送方, 只接受它的ArtSync
 
-    // 数据缓冲区
+    // 接收缓冲区, ArtDmx负载直接从这里送往各输出
     uint8_t artnetBuffer[1024];
-    uint8_t dmxBuffer[DMX_UNIVERSE_SIZE];
-    uint8_t pixelBuffer[MAX_PIXELS * 3];
+
+    // 路由表: routeIndex 以完整15位端口地址散列, 线性探测, 槽内为 routes 下标
+    Route routes[ARTNET_MAX_ROUTES];
+    uint8_t routeCount;
+    uint8_t routeIndex[ARTNET_ROUTE_SLOTS];
+    uint32_t routeGeneration;
+    uint16_t pixelRouteMask;     // 已路由的像素段
+    uint16_t pixelPendingMask;   // 本帧已到达的像素段
+    uint32_t pixelPendingTime;   // 本帧第一个像素段到达的时间
+
+    // 合并引擎: 每个路由按IP跟踪最多两个源
+    struct MergeSource {
+        uint32_t ip;         // 0 表示空闲
+        uint32_t lastSeen;
+        uint8_t* data;       // 仅HTP合并期间分配
+        uint16_t length;
+        uint8_t sequence;    // 最近接受的ArtDmx序号, 0 表示未启用
+    };
+    MergeSource sources[ARTNET_MAX_ROUTES][ARTNET_MAX_SOURCES];
+    uint32_t mergeOutput[ARTNET_DMX_LENGTH / 4];  // 按字对齐, 供SWAR使用
+
+    // 输入端口: packet 为预先填好的ArtDmx包头+负载, 每帧只改负载和序号
+    struct InputPort {
+        bool active;
+        bool disabled;           // 被OpInput禁用
+        ESP32DMX* source;        // DMX输入源, nullptr 表示本地源
+        uint32_t frameSeq;       // 最近转发的DMX输入帧序号
+        uint32_t lastSend;
+        uint16_t length;         // 当前负载长度(偶数)
+        uint8_t packet[18 + ARTNET_DMX_LENGTH];
+    };
+    InputPort inputs[ARTNET_MAX_INPUTS];
+
+    // RDM设备表与事务结果缓冲
+    RDMTod tods[2];
+    RDMDiscovery discovery[2];
+    RDMUID nodeUid;              // 本机UID, 设置响应器后列入设备表
+    RDMTransaction rdmResult;
+
+    // 控制器表: 输入数据单播给最近发送ArtPoll的控制器, 表空时广播
+    struct Controller {
+        uint32_t ip;
+        uint32_t lastSeen;
+    };
+    Controller controllers[ARTNET_MAX_CONTROLLERS];
+    uint32_t broadcastIp;
+
+    // ArtPollReply 缓存: 配置、IP或端口状态变化时才重新生成
+    uint8_t pollReplies[ARTNET_MAX_REPLY_PAGES][ARTNET_POLL_REPLY_SIZE];
+    uint8_t replyPageCount;
+    bool replyDirty;
+    uint32_t replySignature;   // 生成缓存时的运行状态
+    bool replyPending;
+    uint32_t replyDueTime;
+    uint32_t lastReplyTime;
+    uint8_t replyTargets;      // 待回复的控制器, 按 controllers 下标置位
+    uint16_t replyCounter;     // NodeReport 计数
 
     // 回调函数指针
     void (*dmxCallback)(uint16_t universe, uint8_t* data, uint16_t length);
-    void (*rdmCallback)(uint8_t* data, uint16_t length);
+    uint16_t (*rdmCallback)(const uint8_t* request, uint16_t length, const uint8_t** response);
     void (*pixelCallback)(uint8_t* data, uint16_t length);
 
     // Art-Net包处理方法
-    void handleArtDmx(uint8_t* data, uint16_t length);
-    void handleArtPoll();
-    void handleArtAddress(uint8_t* data, uint16_t length);
-    void handleArtRdm(uint8_t* data, uint16_t length);
-    void handleArtSync();
+    void processPacket(int packetSize);
+    void handleArtDmx(uint8_t* data, uint16_t length, uint32_t sourceIp);
+    void handleArtNzs(uint8_t* data, uint16_t length);
+    void handleArtPoll(uint32_t sourceIp);
+    void handleArtInput(uint8_t* data, uint16_t length, uint32_t sourceIp);
+    void handleArtAddress(uint8_t* data, uint16_t length, uint32_t sourceIp);
+    void handleArtRdm(uint8_t* data, uint16_t length, uint32_t sourceIp);
+    void handleArtTodRequest(uint8_t* data, uint16_t length, uint32_t sourceIp);
+    void handleArtTodControl(uint8_t* data, uint16_t length, uint32_t sourceIp);
+    void handleArtSync(uint32_t sourceIp);
 
     // 辅助方法
     void sendArtPollReply();
+    void schedulePollReply(uint32_t ip);
+    void servicePollReply();
+    void buildPollReplies();
+    uint32_t pollReplySignature() const;
+    uint8_t recordController(uint32_t ip);
+    void serviceInputs();
+    void serviceRdm();
+    void sendTodData(uint8_t port, uint16_t portAddress, uint32_t ip);
+    void sendArtRdm(uint16_t portAddress, const uint8_t* packet, uint16_t length, uint32_t ip);
+    bool rdmPortAddress(uint8_t port, uint16_t& portAddress) const;
+    uint8_t findBindIndex(uint16_t portAddress);
+    void transmitInput(InputPort& input);
+    uint8_t getActiveControllers(uint32_t* ips) const;
+    uint8_t* mergeFrame(uint8_t routeIndex, uint32_t sourceIp, uint8_t* payload, uint16_t& length,
+                        uint8_t sequence);
+    bool acceptSequence(MergeSource& source, uint8_t sequence);
+    bool storeSource(MergeSource& source, const uint8_t* payload, uint16_t length);
+    void releaseSource(MergeSource& source, bool forget);
+    void releaseAllSources();
+    uint8_t findRouteSlot(uint16_t portAddress) const;
     void updateStatus();
+    void applyPendingConfig();
     void initializeDefaults();
     void updateDmxOutput();
+    void checkSyncTimeout();
+    void checkNetworkAddress();
+    void checkPixelTimeout();
+    void showPixels();
     bool isValidArtNet(uint8_t* data, uint16_t size);
+    bool acceptHeader(const uint8_t* header, int length);
 
     // Art-Net ID
     static const uint8_t ARTNET_ID[8];
@@ -30,13 +30,17 @@
 #define DMX_DIR_A_PIN GPIO_NUM_16
 #define DMX_TX_B_PIN GPIO_NUM_18
 #define DMX_DIR_B_PIN GPIO_NUM_19
+#define DMX_RX_A_PIN GPIO_NUM_4     // 收发器RO引脚, 按实际接线修改
+#define DMX_RX_B_PIN GPIO_NUM_21
 
 // 像素LED配置
 #define PIXEL_PIN GPIO_NUM_5
+#define PIXEL_CLOCK_PIN GPIO_NUM_22  // APA102时钟引脚, 按实际接线修改
+#define PIXEL_MAX_OUTPUTS 4          // 并行像素输出数, 每路占用一个RMT通道
+#define PIXEL_OUTPUT_PINS { PIXEL_PIN, GPIO_NUM_25, GPIO_NUM_26, GPIO_NUM_27 }
 #define MAX_PIXELS 1360
 #define DEFAULT_PIXELS 170
 #define PIXEL_COUNT 170
-#define PIXEL_TYPE (NEO_GRB + NEO_KHZ800)  // 添加像素类型定义
 
 // WiFi配置
 #define WIFI_SSID "542628277"
@@ -58,7 +62,12 @@
 #define START_UNIVERSE 0
 #define START_SUBNET 0
 #define MAX_UNIVERSES 4            // 最大支持的宇宙数
+#define PIXELS_PER_UNIVERSE 170    // 每个宇宙承载的RGB像素数
+#define MAX_PIXEL_UNIVERSES ((MAX_PIXELS + PIXELS_PER_UNIVERSE - 1) / PIXELS_PER_UNIVERSE)
+#define PIXEL_MAX_SEGMENTS (MAX_PIXEL_UNIVERSES + PIXEL_MAX_OUTPUTS - 1)  // 每路最后一段可能不满
+#define PIXEL_UNIVERSE_AUTO 0xFFFF  // 像素输出的起始宇宙接在前一路之后
 #define ARTNET_POLL_TIMEOUT 5000   // Art-Net轮询超时时间(ms)
+#define ARTNET_RX_BUDGET 16        // 每次唤醒最多处理的UDP数据包数
 
 // 设备配置
 #define DEVICE_NAME "HuBo-ArtNode"
@@ -121,4 +130,5 @@ enum DMXPorts {
 // 确保关键配置值有效
 static_assert(UART_BUFFER_SIZE >= DMX_BUFFER_SIZE, "UART buffer size must be >= DMX buffer size");
 static_assert(MAX_PIXELS <= 1360, "MAX_PIXELS exceeds hardware limit");
-static_assert(PIXEL_COUNT <= MAX_PIXELS, "PIXEL_COUNT exceeds MAX_PIXELS");
\ No newline at end of file
+static_assert(PIXEL_COUNT <= MAX_PIXELS, "PIXEL_COUNT exceeds MAX_PIXELS");
+static_assert(PIXEL_MAX_SEGMENTS <= 16, "pixel segment mask is 16 bits");
\ No newline at end of file
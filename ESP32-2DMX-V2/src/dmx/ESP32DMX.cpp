@@ -6,13 +6,58 @@ ESP32DMX::ESP32DMX(uart_port_t uartNum)
     , enabled(false)
     , outputting(false)
     , transmitting(false)
+    , writeIndex(0)
+    , readIndex(1)
+    , publishedIndex(1)
+    , mailbox(2)
+    , staged(false)
+    , alternateLength(0)
+    , alternateState(ALT_IDLE)
+    , slotMode(SLOTS_FULL)
+    , fixedSlots(DMX_MAX_CHANNELS)
+    , refreshRate(0)
+    , framePeriodUs(0)
+    , frameTimer(nullptr)
+    , frameCallback(nullptr)
+    , frameCallbackArg(nullptr)
+    , waitingTask(nullptr)
+    , inputMode(false)
+    , uartQueue(nullptr)
+    , rxTask(nullptr)
+    , rxFillIndex(0)
+    , rxReadIndex(2)
+    , rxMailbox(1)
+    , rxFrameSeq(0)
+    , rxPos(0)
+    , rxDiscarded(0)
+    , rxBreakPending(false)
+    , lastInputTime(0)
+    , rdmCapable(false)
+    , rdmHead(0)
+    , rdmTail(0)
+    , rdmDone(0)
+    , rdmPhase(RDM_IDLE)
+    , rdmInterval(1)
+    , rdmFramesSent(0)
+    , needsBreak(false)
+    , leadPhase(LEAD_NONE)
+    , leadMabUs(0)
+    , rdmDeadline(0)
+    , rdmWindowEnd(0)
+    , rdmRxPos(0)
     , frameCount(0)
     , lastFrameTime(0)
-    , frameErrors(0) {
+    , frameErrors(0)
+    , lastFrameCount(0)
+    , lastFrameRate(0)
+    , lastUpdate(0) {
     
     // 初始化DMX缓冲区
-    memset(dmxBuffer, 0, DMX_BUFFER_SIZE);
-    dmxBuffer[0] = 0;  // DMX起始码
+    memset(frameBuffers, 0, sizeof(frameBuffers));  // 起始码均为0
+    for (uint8_t i = 0; i < 3; i++) {
+        frameLengths[i] = DMX_MAX_CHANNELS;
+        rxFrameSeqs[i] = 0;
+    }
     
     // 配置UART参数
     uart_config.baud_rate = DMX_BAUDRATE;
@@ -23,47 +68,9 @@ ESP32DMX::ESP32DMX(uart_port_t uartNum)
     uart_config.source_clk = UART_SCLK_APB;
 }
 
-// 发送RDM数据
-void ESP32DMX::sendRDM(uint8_t* data, uint16_t length) {
-    if (!enabled || !data || length == 0) return;
-
-    // 保存当前状态
-    bool wasOutputting = outputting;
-    if (wasOutputting) {
-        stopOutput();
-    }
-
-    // 发送RDM帧
-    sendBreak(176);  // RDM break time = 176µs
-    sendMAB();       // Mark After Break
-
-    // 设置RDM波特率 (250kbps)
-    uart_set_baudrate(uartNum, 250000);
-
-    // 设置DE引脚为发送模式
-    if (dirPin != GPIO_NUM_NC) {
-        gpio_set_level(dirPin, 1);
-    }
-
-    // 发送RDM数据
-    uart_write_bytes(uartNum, (const char*)data, length);
-    uart_wait_tx_done(uartNum, portMAX_DELAY);
-
-    // 添加额外延迟以确保数据发送完成
-    delayMicroseconds(50);
-
-    // 设置DE引脚为接收模式
-    if (dirPin != GPIO_NUM_NC) {
-        gpio_set_level(dirPin, 0);
-    }
-
-    // 恢复DMX波特率
-    uart_set_baudrate(uartNum, DMX_BAUDRATE);
-
-    // 恢复之前的状态
-    if (wasOutputting) {
-        startOutput();
-    }
+// 发送RDM数据: 排入事务队列, 由DMX发送器在帧间发出并收集应答
+bool ESP32DMX::sendRDM(const uint8_t* data, uint16_t length, uint32_t tag) {
+    return queueRDM(data, length, tag);
 }
 
 // 析构函数
@@ -72,7 +79,7 @@ ESP32DMX::~ESP32DMX() {
 }
 
 // 初始化UART和GPIO引脚
-bool ESP32DMX::begin(gpio_num_t txPin, gpio_num_t dirPin) {
+bool ESP32DMX::begin(gpio_num_t txPin, gpio_num_t dirPin, gpio_num_t rxPin) {
     this->txPin = txPin;
     this->dirPin = dirPin;
 
@@ -86,24 +93,82 @@ bool ESP32DMX::begin(gpio_num_t txPin, gpio_num_t dirPin) {
         return false;
     }
 
-    // 安装UART驱动
-    err = uart_driver_install(uartNum, DMX_BUFFER_SIZE, 0, 0, NULL, 0);
+    // 安装UART驱动, TX环形缓冲区可容纳两帧, 写入立即返回
+    err = uart_driver_install(uartNum, DMX_BUFFER_SIZE, DMX_TX_RING_SIZE, 0, NULL, 0);
     if (err != ESP_OK) {
         log_e("UART driver install failed");
         return false;
     }
 
-    // 设置UART引脚
-    err = uart_set_pin(uartNum, txPin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    // 帧尾Break之后的空闲位即MAB
+    uart_set_tx_idle_num(uartNum, DMX_MAB_US / DMX_BIT_US);
+
+    // 创建帧完成定时器
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = &ESP32DMX::frameTimerCallback;
+    timerArgs.arg = this;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = "dmx_frame";
+    if (esp_timer_create(&timerArgs, &frameTimer) != ESP_OK) {
+        log_e("DMX frame timer create failed");
+        return false;
+    }
+
+    // 设置UART引脚, RX引脚用于接收RDM应答
+    err = uart_set_pin(uartNum, txPin, rxPin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
     if (err != ESP_OK) {
         log_e("UART pin config failed");
         return false;
     }
 
+    rdmCapable = rxPin != GPIO_NUM_NC;
     enabled = true;
     return true;
 }
 
+// 初始化为DMX接收端口: 方向引脚保持接收, UART事件驱动收帧
+bool ESP32DMX::beginInput(gpio_num_t rxPin, gpio_num_t dirPin) {
+    this->txPin = GPIO_NUM_NC;
+    this->dirPin = dirPin;
+
+    configurePins();
+
+    esp_err_t err = uart_param_config(uartNum, &uart_config);
+    if (err != ESP_OK) {
+        log_e("UART config failed");
+        return false;
+    }
+
+    // 安装带事件队列的UART驱动
+    err = uart_driver_install(uartNum, DMX_BUFFER_SIZE * 2, 0, 20, &uartQueue, 0);
+    if (err != ESP_OK) {
+        log_e("UART driver install failed");
+        return false;
+    }
+
+    err = uart_set_pin(uartNum, UART_PIN_NO_CHANGE, rxPin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    if (err != ESP_OK) {
+        log_e("UART pin config failed");
+        return false;
+    }
+
+    // 按块进入环形缓冲区; 帧尾不足一块的字节由接收超时送出
+    uart_set_rx_full_threshold(uartNum, DMX_RX_FIFO_THRESHOLD);
+    uart_set_rx_timeout(uartNum, DMX_RX_TIMEOUT);
+
+    inputMode = true;
+    outputting = false;
+    enabled = true;
+
+    if (xTaskCreatePinnedToCore(uartEventHandler, "DMX RX", 3072, this,
+                                TASK_PRIORITY + 1, &rxTask, 0) != pdPASS) {
+        log_e("DMX RX task create failed");
+        end();
+        return false;
+    }
+    return true;
+}
+
 // 配置GPIO引脚
 void ESP32DMX::configurePins() {
     gpio_config_t io_conf = {};
@@ -134,68 +199,265 @@ void ESP32DMX::stopOutput() {
     outputting = false;
 }
 
-// 设置DMX通道数据
+// 设置DMX通道数据(写入暂存帧, 需 commitFrame 生效)
 void ESP32DMX::setChannel(uint16_t channel, uint8_t value) {
-    if (validateChannel(channel)) {
-        dmxBuffer[channel] = value;
+    if (!validateChannel(channel)) return;
+    if (!staged) {
+        memcpy(frameBuffers[writeIndex], frameBuffers[publishedIndex], DMX_BUFFER_SIZE);
+        frameLengths[writeIndex] = frameLengths[publishedIndex];
+        staged = true;
     }
+    frameBuffers[writeIndex][channel] = value;
 }
 
 // 获取DMX通道数据
 uint8_t ESP32DMX::getChannel(uint16_t channel) const {
     if (validateChannel(channel)) {
-        return dmxBuffer[channel];
+        return frameBuffers[publishedIndex][channel];
     }
     return 0;
 }
 
-// 清空DMX通道数据
-void ESP32DMX::clearChannels() {
-    memset(dmxBuffer + 1, 0, DMX_BUFFER_SIZE - 1);
+// 批量设置DMX通道数据
+void ESP32DMX::setChannels(const uint8_t* data, uint16_t length) {
+    stageChannels(data, length);
+    commitFrame();
 }
 
-// 开始DMX帧
-void ESP32DMX::startFrame() {
-    if (!enabled || !outputting) return;
-    
-    sendBreak(DMX_BREAK_US);
-    sendMAB();
+// 写入暂存帧, 未覆盖的通道清零
+void ESP32DMX::stageChannels(const uint8_t* data, uint16_t length) {
+    if (!data) return;
+    if (length > DMX_MAX_CHANNELS) {
+        length = DMX_MAX_CHANNELS;
+    }
+    uint8_t* frame = frameBuffers[writeIndex];
+    frame[0] = 0;  // DMX起始码
+    memcpy(frame + 1, data, length);
+    memset(frame + 1 + length, 0, DMX_MAX_CHANNELS - length);
+    frameLengths[writeIndex] = length;
+    staged = true;
 }
 
-// 结束DMX帧
-void ESP32DMX::endFrame() {
-    if (!enabled || !outputting) return;
-    
-    waitForTransmitComplete();
-    frameCount++;
-    lastFrameTime = millis();
+// 写入非零起始码帧, 尚未发出的上一帧被替换
+bool ESP32DMX::sendAlternateFrame(uint8_t startCode, const uint8_t* data, uint16_t length) {
+    if (!data || startCode == 0) return false;
+    if (length > DMX_MAX_CHANNELS) {
+        length = DMX_MAX_CHANNELS;
+    }
+
+    uint8_t state = alternateState.load(std::memory_order_relaxed);
+    if (state == ALT_SENDING ||
+        !alternateState.compare_exchange_strong(state, ALT_WRITING, std::memory_order_acquire)) {
+        return false;
+    }
+    alternateFrame[0] = startCode;
+    memcpy(alternateFrame + 1, data, length);
+    alternateLength = length;
+    alternateState.store(ALT_READY, std::memory_order_release);
+    return true;
+}
+
+// 提交暂存帧: 与邮箱交换, 换回的缓冲区作为新的暂存帧
+void ESP32DMX::commitFrame() {
+    if (!staged) return;
+    publishedIndex = writeIndex;
+    writeIndex = mailbox.exchange(writeIndex | FRAME_FRESH, std::memory_order_acq_rel) & FRAME_INDEX_MASK;
+    staged = false;
 }
 
-// 发送Break信号
-void ESP32DMX::sendBreak(uint32_t breakTime) {
-    uart_set_baudrate(uartNum, 1000000 / breakTime);
-    uart_write_bytes(uartNum, "\0", 1);
-    uart_wait_tx_done(uartNum, portMAX_DELAY);
-    uart_set_baudrate(uartNum, DMX_BAUDRATE);
+// DMX任务取帧: 邮箱中有新帧时与之交换, 否则继续发送上一帧
+uint8_t* ESP32DMX::acquireFrame() {
+    if (mailbox.load(std::memory_order_acquire) & FRAME_FRESH) {
+        readIndex = mailbox.exchange(readIndex, std::memory_order_acq_rel) & FRAME_INDEX_MASK;
+    }
+    return frameBuffers[readIndex];
 }
 
-// 发送MAB信号
-void ESP32DMX::sendMAB() {
-    delayMicroseconds(DMX_MAB_US);
+// 清空DMX通道数据
+void ESP32DMX::clearChannels() {
+    memset(frameBuffers[writeIndex], 0, DMX_BUFFER_SIZE);
+    frameLengths[writeIndex] = DMX_MAX_CHANNELS;
+    staged = true;
+    commitFrame();
 }
 
 // 更新DMX数据
 void ESP32DMX::update() {
     if (!enabled || !outputting) return;
 
-    startFrame();
-    write(dmxBuffer, DMX_BUFFER_SIZE);
-    endFrame();
+    transmitFrame();
+}
+
+// 启动一帧发送, 不等待完成.
+// 帧结构为 [起始码+数据][Break][MAB]: 本帧尾部的Break/MAB即下一帧的帧头,
+// 上电后的第一帧没有前导Break, 接收端会忽略该帧.
+bool ESP32DMX::transmitFrame() {
+    if (!enabled || !outputting || transmitting) return false;
+    // 上一帧或RDM请求还没完全移出FIFO时不能开始Break
+    if (uart_wait_tx_done(uartNum, 0) != ESP_OK) return false;
+
+    transmitting = true;
+
+    // 每发 rdmInterval 个DMX帧插入一个RDM窗口, DMX刷新率的下降有上限
+    if (rdmFramesSent >= rdmInterval &&
+        rdmHead.load(std::memory_order_acquire) != rdmTail.load(std::memory_order_acquire)) {
+        rdmFramesSent = 0;
+        startRDMTransaction();
+        return true;
+    }
+    if (rdmFramesSent < rdmInterval) {
+        rdmFramesSent++;
+    }
+    if (needsBreak) {
+        // 前导Break/MAB由定时器推进, 结束后在定时器任务中写出本帧
+        needsBreak = false;
+        startLeadingBreak(DMX_MAB_US);
+        return true;
+    }
+    writeFrame();
+    return true;
+}
+
+// 把下一帧写入TX环形缓冲区并预约完成回调
+void ESP32DMX::writeFrame() {
+    uint16_t slots;
+    uint8_t expected = ALT_READY;
+    if (alternateState.compare_exchange_strong(expected, ALT_SENDING, std::memory_order_acquire)) {
+        // 非零起始码帧按到达的长度原样发送, 写入TX环形缓冲区后即可释放
+        slots = alternateLength;
+        uart_write_bytes_with_break(uartNum, alternateFrame, slots + 1, DMX_BREAK_US / DMX_BIT_US);
+        alternateState.store(ALT_IDLE, std::memory_order_release);
+    } else {
+        uint8_t* frame = acquireFrame();
+        slots = slotsForLength(frameLengths[readIndex]);
+        uart_write_bytes_with_break(uartNum, frame, slots + 1, DMX_BREAK_US / DMX_BIT_US);
+    }
+
+    // 按线上时长预约完成回调, 设定了刷新率时延长到帧周期(表现为更长的MAB).
+    // 定时器只给出下限, 回调中再确认UART已发送完毕
+    uint32_t frameUs = (slots + 1) * DMX_SLOT_US + DMX_BREAK_US + DMX_MAB_US;
+    if (frameUs < framePeriodUs) {
+        frameUs = framePeriodUs;
+    }
+    if (frameUs < DMX_MIN_FRAME_US) {
+        frameUs = DMX_MIN_FRAME_US;
+    }
+    esp_timer_start_once(frameTimer, frameUs);
+}
+
+void ESP32DMX::setSlotMode(DMXSlotMode mode, uint16_t slots) {
+    if (slots < 1) slots = 1;
+    if (slots > DMX_MAX_CHANNELS) slots = DMX_MAX_CHANNELS;
+    fixedSlots = slots;
+    slotMode = mode;
+}
+
+void ESP32DMX::setRefreshRate(uint16_t hz) {
+    refreshRate = hz;
+    framePeriodUs = hz ? 1000000UL / hz : 0;
+}
+
+uint16_t ESP32DMX::slotsForLength(uint16_t length) const {
+    switch (slotMode) {
+        case SLOTS_AUTO:
+            return length > DMX_MAX_CHANNELS ? DMX_MAX_CHANNELS : length;
+        case SLOTS_FIXED:
+            return fixedSlots;
+        default:
+            return DMX_MAX_CHANNELS;
+    }
+}
+
+void ESP32DMX::setFrameCallback(void (*callback)(ESP32DMX* dmx, void* arg), void* arg) {
+    frameCallbackArg = arg;
+    frameCallback = callback;
+}
+
+void ESP32DMX::frameTimerCallback(void* arg) {
+    ESP32DMX* dmx = static_cast<ESP32DMX*>(arg);
+    if (dmx->leadPhase != LEAD_NONE) {
+        dmx->handleLeadingBreak();
+    } else if (dmx->rdmPhase != RDM_IDLE) {
+        dmx->handleRDMTimer();
+    } else {
+        dmx->handleFrameComplete();
+    }
+}
+
+// 帧完成(在 esp_timer 任务中执行)
+void ESP32DMX::handleFrameComplete() {
+    // 估算时间已到但FIFO未空(中断延迟等), 再等一个槽位
+    if (uart_wait_tx_done(uartNum, 0) != ESP_OK) {
+        esp_timer_start_once(frameTimer, DMX_SLOT_US);
+        return;
+    }
+    recordFrame(millis());
+
+    transmitting = false;
+    if (frameCallback) {
+        frameCallback(this, frameCallbackArg);
+    }
+    notifyWaitingTask();
 }
 
-// 等待传输完成
-void ESP32DMX::waitForTransmitComplete() {
-    uart_wait_tx_done(uartNum, portMAX_DELAY);
+void ESP32DMX::notifyWaitingTask() {
+    TaskHandle_t task = waitingTask;
+    if (task) {
+        waitingTask = nullptr;
+        xTaskNotifyGive(task);
+    }
+}
+
+// 记录一帧(发送完成或接收完成), 每秒统计一次帧率
+void ESP32DMX::recordFrame(uint32_t now) {
+    frameCount++;
+    lastFrameTime = now;
+
+    if (now - lastUpdate >= 1000) {
+        lastFrameRate = (frameCount - lastFrameCount) * 1000 / (now - lastUpdate);
+        lastFrameCount = frameCount;
+        lastUpdate = now;
+    }
+}
+
+uint32_t ESP32DMX::getFrameRate() const {
+    // 超过2秒无帧视为停止输出
+    if (millis() - lastFrameTime > 2000) {
+        return 0;
+    }
+    return lastFrameRate;
+}
+
+// 两个UART各按自己的帧长连续发送: 空闲的端口立即启动下一帧, 调用任务睡眠到任一端完成.
+// 两端同时空闲时(首帧)一起启动, 之后短帧端口不再等待长帧端口
+uint8_t ESP32DMX::transmitPair(ESP32DMX& a, ESP32DMX& b) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    ESP32DMX* ports[2] = {&a, &b};
+    uint8_t active = 0;
+
+    // 之前的通知已由下面的 transmitting 判断处理, 清掉以免立即返回
+    xTaskNotifyStateClear(self);
+    ulTaskNotifyValueClear(self, 0xFFFFFFFF);
+
+    for (uint8_t i = 0; i < 2; i++) {
+        ESP32DMX* port = ports[i];
+        if (!port->transmitting) {
+            port->waitingTask = self;
+            if (!port->transmitFrame()) {
+                port->waitingTask = nullptr;
+            }
+        }
+        if (port->transmitting) {
+            active++;
+        }
+    }
+    if (active == 0) {
+        return 0;
+    }
+
+    // 任一端完成即返回, 由下一次调用只重启该端. 超时保护: 一帧最长约23ms
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));
+    return active;
 }
 
 // 验证通道号是否合法
@@ -207,14 +469,310 @@ bool ESP32DMX::validateChannel(uint16_t channel) const {
 void ESP32DMX::end() {
     if (enabled) {
         stopOutput();
+        if (rxTask) {
+            vTaskDelete(rxTask);
+            rxTask = nullptr;
+        }
+        inputMode = false;
+        rdmCapable = false;
+        rdmPhase = RDM_IDLE;
+        leadPhase = LEAD_NONE;
+        rdmFramesSent = 0;
+        rdmDone = 0;
+        rdmHead.store(0);
+        rdmTail.store(0);
+        if (frameTimer) {
+            esp_timer_stop(frameTimer);
+            esp_timer_delete(frameTimer);
+            frameTimer = nullptr;
+        }
         uart_driver_delete(uartNum);
         enabled = false;
+        transmitting = false;
     }
 }
 
-// 实现write函数
-void ESP32DMX::write(uint8_t* data, uint16_t length) {
-    if (enabled) {
-        uart_write_bytes(uartNum, (const char*)data, length);
+// 加入RDM请求队列(请求须含起始码0xCC和校验和)
+bool ESP32DMX::queueRDM(const uint8_t* request, uint16_t length, uint32_t tag) {
+    if (!rdmCapable || !outputting || !request || length < 3 || length > RDM_MAX_PACKET) {
+        return false;
+    }
+
+    uint8_t tail = rdmTail.load(std::memory_order_relaxed);
+    uint8_t next = (tail + 1) % RDM_QUEUE_DEPTH;
+    if (next == rdmDone) {
+        return false;  // 队列已满
+    }
+
+    RDMTransaction& transaction = rdmQueue[tail];
+    memcpy(transaction.data, request, length);
+    transaction.length = length;
+    transaction.tag = tag;
+    transaction.status = RDM_STATUS_PENDING;
+    rdmTail.store(next, std::memory_order_release);
+    return true;
+}
+
+// 取回一个已完成的事务
+bool ESP32DMX::readRDMResult(RDMTransaction& result) {
+    if (rdmDone == rdmHead.load(std::memory_order_acquire)) {
+        return false;
+    }
+    const RDMTransaction& transaction = rdmQueue[rdmDone];
+    result.length = transaction.length;
+    result.tag = transaction.tag;
+    result.status = transaction.status;
+    memcpy(result.data, transaction.data, transaction.length);
+    rdmDone = (rdmDone + 1) % RDM_QUEUE_DEPTH;
+    return true;
+}
+
+// 手动产生Break: 反相TX引脚, 由帧定时器结束Break和MAB, 不占用调用方.
+// 仅在FIFO已空时调用(见 transmitFrame)
+void ESP32DMX::startLeadingBreak(uint32_t mabUs) {
+    uart_set_line_inverse(uartNum, UART_SIGNAL_TXD_INV);
+    leadMabUs = mabUs;
+    leadPhase = LEAD_BREAK;
+    esp_timer_start_once(frameTimer, DMX_BREAK_US);
+}
+
+// 前导Break/MAB结束(在 esp_timer 任务中执行), 随后发出等待中的RDM请求或DMX帧
+void ESP32DMX::handleLeadingBreak() {
+    if (leadPhase == LEAD_BREAK) {
+        uart_set_line_inverse(uartNum, UART_SIGNAL_INV_DISABLE);
+        leadPhase = LEAD_MAB;
+        esp_timer_start_once(frameTimer, leadMabUs);
+        return;
+    }
+
+    leadPhase = LEAD_NONE;
+    if (rdmPhase == RDM_SENDING) {
+        sendRDMRequest();
+    } else {
+        writeFrame();
+    }
+}
+
+// 开始队首请求(DMX任务). RDM请求需要前导Break且尾部不能带Break,
+// 因此不使用 uart_write_bytes_with_break
+void ESP32DMX::startRDMTransaction() {
+    rdmPhase = RDM_SENDING;
+    startLeadingBreak(RDM_MAB_US);
+}
+
+// MAB结束后写出请求(在 esp_timer 任务中执行)
+void ESP32DMX::sendRDMRequest() {
+    RDMTransaction& transaction = rdmQueue[rdmHead.load(std::memory_order_relaxed)];
+    uart_write_bytes(uartNum, transaction.data, transaction.length);
+
+    // 发送完成后再留一个槽位的余量
+    esp_timer_start_once(frameTimer, (transaction.length + 1) * DMX_SLOT_US);
+}
+
+// RDM事务状态机(在 esp_timer 任务中执行)
+void ESP32DMX::handleRDMTimer() {
+    RDMTransaction& transaction = rdmQueue[rdmHead.load(std::memory_order_relaxed)];
+    int64_t now = esp_timer_get_time();
+
+    if (rdmPhase == RDM_SENDING) {
+        // 广播请求没有应答; DISC_UNIQUE_BRANCH(CC 0x10, PID 0x0001)除外
+        const uint8_t* dest = &transaction.data[3];
+        bool broadcast = dest[2] == 0xFF && dest[3] == 0xFF && dest[4] == 0xFF && dest[5] == 0xFF;
+        bool discovery = transaction.length > 22 && transaction.data[20] == 0x10 &&
+                         transaction.data[21] == 0x00 && transaction.data[22] == 0x01;
+        if (broadcast && !discovery) {
+            finishRDMTransaction(RDM_STATUS_BROADCAST);
+            return;
+        }
+
+        // 请求的最后一个字节发完才能释放总线
+        if (uart_wait_tx_done(uartNum, 0) != ESP_OK) {
+            esp_timer_start_once(frameTimer, DMX_SLOT_US);
+            return;
+        }
+
+        // 释放总线, 应答方至少在176us后才开始回复
+        gpio_set_level(dirPin, 0);
+        uart_flush_input(uartNum);
+        rdmRxPos = 0;
+        rdmDeadline = now + RDM_RESPONSE_TIMEOUT_US;
+        rdmWindowEnd = now + RDM_MAX_WINDOW_US;
+        rdmPhase = RDM_RECEIVING;
+        esp_timer_start_once(frameTimer, RDM_POLL_US);
+        return;
+    }
+
+    // 读入已到达的字节
+    size_t pending = 0;
+    uart_get_buffered_data_len(uartNum, &pending);
+    if (pending > (size_t)(RDM_MAX_PACKET - rdmRxPos)) {
+        pending = RDM_MAX_PACKET - rdmRxPos;
+    }
+    int got = pending ? uart_read_bytes(uartNum, transaction.data + rdmRxPos, pending, 0) : 0;
+    if (got > 0) {
+        bool first = rdmRxPos == 0;
+        rdmRxPos += got;
+        // 去掉应答方Break产生的0字节
+        if (first) {
+            uint16_t skip = 0;
+            while (skip < rdmRxPos && transaction.data[skip] == 0x00) skip++;
+            memmove(transaction.data, transaction.data + skip, rdmRxPos - skip);
+            rdmRxPos -= skip;
+        }
+        rdmDeadline = now + RDM_INTER_SLOT_US;
+        if (rdmDeadline > rdmWindowEnd) {
+            rdmDeadline = rdmWindowEnd;
+        }
+    }
+
+    if (rdmResponseComplete(transaction)) {
+        finishRDMTransaction(RDM_STATUS_OK);
+    } else if (now >= rdmDeadline) {
+        finishRDMTransaction(rdmRxPos ? RDM_STATUS_OK : RDM_STATUS_TIMEOUT);
+    } else {
+        esp_timer_start_once(frameTimer, RDM_POLL_US);
+    }
+}
+
+// 普通应答按消息长度判断, DUB应答为前导码+0xAA+16字节编码UID
+bool ESP32DMX::rdmResponseComplete(const RDMTransaction& transaction) const {
+    const uint8_t* data = transaction.data;
+    if (rdmRxPos >= RDM_MAX_PACKET) {
+        return true;
+    }
+    if (rdmRxPos >= 3 && data[0] == 0xCC) {
+        return rdmRxPos >= data[2] + 2;
+    }
+    for (uint16_t i = 0; i < rdmRxPos && i < 8; i++) {
+        if (data[i] == 0xAA) {
+            return rdmRxPos >= i + 17;
+        }
+    }
+    return false;
+}
+
+void ESP32DMX::finishRDMTransaction(RDMStatus status) {
+    RDMTransaction& transaction = rdmQueue[rdmHead.load(std::memory_order_relaxed)];
+    transaction.length = status == RDM_STATUS_OK ? rdmRxPos : 0;
+    transaction.status = status;
+
+    // 重新占用总线, 下一帧补发前导Break
+    gpio_set_level(dirPin, 1);
+    needsBreak = true;
+    rdmPhase = RDM_IDLE;
+    rdmHead.store((rdmHead.load(std::memory_order_relaxed) + 1) % RDM_QUEUE_DEPTH,
+                  std::memory_order_release);
+
+    transmitting = false;
+    notifyWaitingTask();
+}
+
+// UART事件任务: 阻塞在事件队列上, 无需轮询
+void ESP32DMX::uartEventHandler(void* arg) {
+    ESP32DMX* dmx = static_cast<ESP32DMX*>(arg);
+    uart_event_t event;
+
+    while (true) {
+        if (xQueueReceive(dmx->uartQueue, &event, portMAX_DELAY) == pdTRUE) {
+            dmx->handleUARTEvent(event);
+        }
+    }
+}
+
+void ESP32DMX::handleUARTEvent(uart_event_t& event) {
+    switch (event.type) {
+        case UART_DATA:
+            readInputBytes();
+            if (rxBreakPending) {
+                // 接收超时送出的帧尾(含Break字节)
+                rxBreakPending = false;
+                finishInputFrame();
+            }
+            break;
+        case UART_BREAK: {
+            // Break标志着上一帧结束. 驱动只在FIFO满或超时时搬运数据,
+            // 硬件FIFO中还有字节时等下一个 UART_DATA 再结束本帧
+            bool tailPending = uart_ll_get_rxfifo_len(UART_LL_GET_HW(uartNum)) > 0;
+            readInputBytes();
+            if (tailPending) {
+                rxBreakPending = true;
+            } else {
+                finishInputFrame();
+            }
+            break;
+        }
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            frameErrors++;
+            uart_flush_input(uartNum);
+            xQueueReset(uartQueue);
+            rxPos = 0;
+            rxDiscarded = 0;
+            rxBreakPending = false;
+            break;
+        case UART_PARITY_ERR:
+            frameErrors++;
+            break;
+        case UART_FRAME_ERR:
+            // 每个Break都会产生一次帧错误, 不计入统计
+            break;
+        default:
+            break;
+    }
+}
+
+// 把环形缓冲区中的字节直接读入当前接收缓冲区
+void ESP32DMX::readInputBytes() {
+    size_t pending = 0;
+    uart_get_buffered_data_len(uartNum, &pending);
+
+    while (pending > 0) {
+        uint8_t* frame = frameBuffers[rxFillIndex];
+        int got;
+        if (rxPos < DMX_BUFFER_SIZE) {
+            size_t space = DMX_BUFFER_SIZE - rxPos;
+            got = uart_read_bytes(uartNum, frame + rxPos, pending < space ? pending : space, 0);
+            if (got > 0) rxPos += got;
+        } else {
+            uint8_t scratch[16];
+            got = uart_read_bytes(uartNum, scratch, pending < sizeof(scratch) ? pending : sizeof(scratch), 0);
+            if (got > 0) rxDiscarded += got;
+        }
+        if (got <= 0) break;
+        pending -= got;
+    }
+}
+
+// 完成一帧: 最后一个字节是Break本身产生的0字节, 去掉后与邮箱交换发布
+void ESP32DMX::finishInputFrame() {
+    uint16_t received = rxPos;
+    if (rxDiscarded > 0) {
+        rxDiscarded--;
+    } else if (received > 0) {
+        received--;
+    }
+
+    if (rxDiscarded > 0) {
+        // 超长帧
+        frameErrors++;
+    } else if (received > 0) {
+        frameLengths[rxFillIndex] = received - 1;
+        rxFrameSeqs[rxFillIndex] = ++rxFrameSeq;
+        rxFillIndex = rxMailbox.exchange(rxFillIndex | FRAME_FRESH, std::memory_order_acq_rel) & FRAME_INDEX_MASK;
+        lastInputTime = esp_timer_get_time();
+        recordFrame(millis());
+    }
+
+    rxPos = 0;
+    rxDiscarded = 0;
+}
+
+// 邮箱中有新帧时与之交换, 读取方持有的缓冲区不会被接收任务改写
+uint32_t ESP32DMX::readInputFrame(const uint8_t*& data, uint16_t& length) {
+    if (rxMailbox.load(std::memory_order_acquire) & FRAME_FRESH) {
+        rxReadIndex = rxMailbox.exchange(rxReadIndex, std::memory_order_acq_rel) & FRAME_INDEX_MASK;
     }
+    data = frameBuffers[rxReadIndex];
+    length = frameLengths[rxReadIndex];
+    return rxFrameSeqs[rxReadIndex];
 }
\ No newline at end of file
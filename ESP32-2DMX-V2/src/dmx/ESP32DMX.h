@@ -3,14 +3,45 @@
 #include <Arduino.h>
 #include <driver/uart.h>
 #include <driver/gpio.h>
+#include <hal/uart_ll.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/queue.h>
+#include <esp_timer.h>
+#include <atomic>
 #include "config.h"  // 包含配置文件
 
 #define DMX_MAX_CHANNELS 512  // 定义DMX的最大通道数
 #define DMX_BUFFER_SIZE (DMX_MAX_CHANNELS + 1)  // 加上起始码的大小
 
+#define RDM_MAX_PACKET 257     // 含起始码和校验和
+#define RDM_QUEUE_DEPTH 4      // 每端口排队的RDM事务数
+
+#define DMX_RX_FIFO_THRESHOLD 100  // 接收FIFO满该字节数才进中断, 硬件FIFO共128字节
+#define DMX_RX_TIMEOUT 1           // 接收超时(字符时间), 帧尾不足阈值的字节在Break期间送出
+
+// RDM事务结果
+enum RDMStatus : uint8_t {
+    RDM_STATUS_PENDING = 0,
+    RDM_STATUS_OK,          // 收到响应
+    RDM_STATUS_TIMEOUT,     // 应答超时
+    RDM_STATUS_BROADCAST    // 广播请求, 不等待响应
+};
+
+// RDM事务: 请求发出后 data 被替换为收到的响应
+struct RDMTransaction {
+    uint8_t data[RDM_MAX_PACKET];
+    uint16_t length;
+    uint32_t tag;           // 调用方标记, 随结果原样返回
+    RDMStatus status;
+};
+
+// 每帧发送的槽位数
+enum DMXSlotMode {
+    SLOTS_AUTO = 0,   // 跟随最近一次写入的长度, 短帧以加长MAB满足最小帧间隔
+    SLOTS_FIXED = 1,  // 固定槽位数
+    SLOTS_FULL = 2    // 始终发送512个槽位
+};
 
 class ESP32DMX {
 public:
@@ -21,20 +52,43 @@ public:
     static const uint32_t RDM_BAUDRATE = 250000;
     static const uint32_t DMX_BREAK_US = 176;
     static const uint32_t DMX_MAB_US = 12;
+    static const uint32_t DMX_SLOT_US = 44;  // 每个槽位11位 @ 250kbps
+    static const uint32_t DMX_BIT_US = 4;
+    static const uint32_t DMX_MIN_FRAME_US = 1204;  // Break到Break的最小间隔
+    static const uint32_t RDM_MAB_US = 88;                // RDM请求的最小MAB
+    static const uint32_t RDM_RESPONSE_TIMEOUT_US = 2800; // 控制器等待应答的时间
+    static const uint32_t RDM_INTER_SLOT_US = 2100;       // 应答字节间的最大间隔
+    static const uint32_t RDM_POLL_US = 264;              // 接收应答时的检查间隔
+    // 应答窗口上限: 等待时间加一个最长应答包, 字节间隔再慢也不延长
+    static const uint32_t RDM_MAX_WINDOW_US = RDM_RESPONSE_TIMEOUT_US + RDM_MAX_PACKET * DMX_SLOT_US;
+    static const uint32_t DMX_TX_RING_SIZE = DMX_BUFFER_SIZE * 2;
 
     void end();
-    void update();
+    void update();  // 非阻塞: 空闲时发出下一帧
+
+    // 非阻塞帧发送: 数据写入TX环形缓冲区, 由UART硬件在帧尾产生Break和MAB
+    bool transmitFrame();
+    bool isBusy() const { return transmitting; }
+    void setFrameCallback(void (*callback)(ESP32DMX* dmx, void* arg), void* arg = nullptr);
+
+    // 双端口调度: 启动空闲端口的下一帧并阻塞到任一端完成, 两端各按自己的帧率发送.
+    // 返回正在发送的端口数, 0 表示两端都未输出
+    static uint8_t transmitPair(ESP32DMX& a, ESP32DMX& b);
+
+    // 帧长度与刷新率
+    void setSlotMode(DMXSlotMode mode, uint16_t fixedSlots = DMX_MAX_CHANNELS);
+    DMXSlotMode getSlotMode() const { return slotMode; }
+    void setRefreshRate(uint16_t hz);  // 0 表示尽可能快
+    uint16_t getRefreshRate() const { return refreshRate; }
 
     // RDM相关方法
-    void sendRDM(uint8_t* data, uint16_t length);
-    void sendBreak(uint32_t breakTime = 176); // 默认176微秒
-    void sendMAB();  // 声明sendMAB函数
-    bool begin(gpio_num_t txPin, gpio_num_t dirPin);
-    void write(uint8_t* data, uint16_t length);  // 声明write函数
+    bool sendRDM(const uint8_t* data, uint16_t length, uint32_t tag);  // 同 queueRDM, 不停止DMX输出
+    bool begin(gpio_num_t txPin, gpio_num_t dirPin, gpio_num_t rxPin = GPIO_NUM_NC);  // 提供rxPin时支持RDM
+    bool beginInput(gpio_num_t rxPin, gpio_num_t dirPin);  // DMX512接收模式
     void clearBuffer();
 
-    // 获取DMX数据的方法
-    uint8_t* getDMXData() { return buffer + 1; }  // +1 跳过起始码
+    // 获取最近提交的DMX数据(网络侧调用)
+    uint8_t* getDMXData() { return frameBuffers[publishedIndex] + 1; }  // +1 跳过起始码
 
     // DMX控制
     void startOutput();
@@ -44,17 +98,38 @@ public:
     // DMX数据操作
     void setChannel(uint16_t channel, uint8_t value);
     uint8_t getChannel(uint16_t channel) const;
+    // 以下写入方法只能由单一生产者(网络任务)调用
+    void setChannels(const uint8_t* data, uint16_t length);  // 从通道1开始批量写入并立即生效
+    void stageChannels(const uint8_t* data, uint16_t length);  // 写入暂存帧, 等待提交
+    void commitFrame();  // 发布暂存帧, DMX任务下一帧取用
+    bool hasStagedFrame() const { return staged; }
+    // 非零起始码帧: 按原长度只发送一次, 之后恢复发送最近的DMX帧; 上一帧尚在发送时返回false
+    bool sendAlternateFrame(uint8_t startCode, const uint8_t* data, uint16_t length);
     void clearChannels();
 
-    // DMX帧控制
-    void startFrame();
-    void endFrame();
-    bool write(const uint8_t* data, size_t length);
+    // DMX输入: 取最近一帧完整数据(data[0]为起始码, length为槽位数),
+    // 返回帧序号, 0 表示尚未收到任何帧. 只能由单一读取方调用, data 在下次调用前有效
+    uint32_t readInputFrame(const uint8_t*& data, uint16_t& length);
+    bool isInput() const { return inputMode; }
+    int64_t getLastInputTime() const { return lastInputTime; }  // 最近一帧的时间戳(us)
+
+    // RDM事务队列: 请求在DMX帧之间发出, 等待应答期间不阻塞DMX任务.
+    // queueRDM/readRDMResult 只能由同一个任务(网络任务)调用.
+    // tag 原样带回结果, 0 保留给发现引擎(RDM_TAG_DISCOVERY), 其他调用方不得使用
+    bool queueRDM(const uint8_t* request, uint16_t length, uint32_t tag);
+    bool readRDMResult(RDMTransaction& result);
+    bool isRDMCapable() const { return rdmCapable; }
+    // 两个RDM窗口之间至少发送的DMX帧数. 窗口不超过 RDM_MAX_WINDOW_US 加请求发送时间,
+    // 因此排满RDM事务时DMX帧率不低于 n / (n * 帧时间 + 窗口时间)
+    void setRDMInterval(uint8_t frames) { rdmInterval = frames ? frames : 1; }
+    uint8_t getRDMInterval() const { return rdmInterval; }
 
     // 状态查询
     bool isEnabled() const { return enabled; }
     uint32_t getFrameCount() const { return frameCount; }
     uint32_t getLastFrameTime() const { return lastFrameTime; }
+    uint32_t getFrameRate() const;  // 实际帧率(Hz)
+    uint32_t getFrameErrors() const { return frameErrors; }
 
 private:
     uart_port_t uartNum;
@@ -62,15 +137,94 @@ private:
     gpio_num_t dirPin;
     uart_config_t uart_config;
 
-    uint8_t buffer[DMX_MAX_CHANNELS + 1];  // +1 for start code
-
     // 状态标志
     bool enabled;
     bool outputting;
     volatile bool transmitting;
 
-    // DMX缓冲区
-    uint8_t dmxBuffer[DMX_BUFFER_SIZE];
+    // DMX三缓冲(最新帧优先的无锁邮箱):
+    // writeIndex 归网络任务, readIndex 归发送方(DMX任务; 补发前导Break后为定时器任务,
+    // transmitting 保证两者不会同时取帧), mailbox 存放中间缓冲区
+    static const uint8_t FRAME_INDEX_MASK = 0x03;
+    static const uint8_t FRAME_FRESH = 0x04;
+    uint8_t frameBuffers[3][DMX_BUFFER_SIZE];
+    uint16_t frameLengths[3];  // 每个缓冲区的有效通道数
+    uint8_t writeIndex;
+    uint8_t readIndex;
+    uint8_t publishedIndex;
+    std::atomic<uint8_t> mailbox;
+    bool staged;
+
+    uint8_t* acquireFrame();  // DMX任务取最新完整帧
+
+    // 非零起始码帧的单帧缓冲区, 状态见 ALT_* 常量
+    static const uint8_t ALT_IDLE = 0;
+    static const uint8_t ALT_WRITING = 1;
+    static const uint8_t ALT_READY = 2;
+    static const uint8_t ALT_SENDING = 3;
+    uint8_t alternateFrame[DMX_BUFFER_SIZE];
+    uint16_t alternateLength;
+    std::atomic<uint8_t> alternateState;
+
+    // 帧长度与帧间隔
+    DMXSlotMode slotMode;
+    uint16_t fixedSlots;
+    uint16_t refreshRate;
+    uint32_t framePeriodUs;
+    uint16_t slotsForLength(uint16_t length) const;
+
+    // 帧完成定时器
+    esp_timer_handle_t frameTimer;
+    void (*frameCallback)(ESP32DMX* dmx, void* arg);
+    void* frameCallbackArg;
+    volatile TaskHandle_t waitingTask;  // transmitPair 等待中的任务
+    static void frameTimerCallback(void* arg);
+    void handleFrameComplete();
+    void writeFrame();
+
+    // DMX输入: 复用三个帧缓冲区, 与输出相同的最新帧优先邮箱.
+    // rxFillIndex 归接收任务, rxReadIndex 归读取方, rxMailbox 存放中间缓冲区
+    bool inputMode;
+    QueueHandle_t uartQueue;
+    TaskHandle_t rxTask;
+    uint8_t rxFillIndex;
+    uint8_t rxReadIndex;
+    std::atomic<uint8_t> rxMailbox;
+    uint32_t rxFrameSeqs[3];          // 每个缓冲区中帧的序号
+    uint32_t rxFrameSeq;
+    uint16_t rxPos;
+    uint16_t rxDiscarded;             // 超出一帧的字节数
+    bool rxBreakPending;              // 已收到Break, 帧尾字节仍在硬件FIFO中
+    volatile int64_t lastInputTime;
+    void readInputBytes();
+    void finishInputFrame();
+
+    // RDM事务: [rdmDone, rdmHead) 已完成待读取, [rdmHead, rdmTail) 待发送
+    enum RDMPhase : uint8_t { RDM_IDLE, RDM_SENDING, RDM_RECEIVING };
+    bool rdmCapable;
+    RDMTransaction rdmQueue[RDM_QUEUE_DEPTH];
+    std::atomic<uint8_t> rdmHead;
+    std::atomic<uint8_t> rdmTail;
+    uint8_t rdmDone;
+    volatile RDMPhase rdmPhase;
+    uint8_t rdmInterval;      // RDM窗口之间的最少DMX帧数
+    uint8_t rdmFramesSent;    // 上个RDM窗口之后已发的DMX帧数
+    bool needsBreak;          // 总线刚释放过, 下一帧需要前导Break
+    // 前导Break: 反相TX引脚 DMX_BREAK_US, 再保持空闲 leadMabUs, 两段均由帧定时器计时
+    enum LeadPhase : uint8_t { LEAD_NONE, LEAD_BREAK, LEAD_MAB };
+    volatile LeadPhase leadPhase;
+    uint32_t leadMabUs;
+    int64_t rdmDeadline;
+    int64_t rdmWindowEnd;     // 应答窗口的硬性截止时间
+    uint16_t rdmRxPos;
+    void startRDMTransaction();
+    void handleRDMTimer();
+    void finishRDMTransaction(RDMStatus status);
+    bool rdmResponseComplete(const RDMTransaction& transaction) const;
+    void startLeadingBreak(uint32_t mabUs);
+    void handleLeadingBreak();
+    void sendRDMRequest();
+    void notifyWaitingTask();
 
     // 统计信息
     uint32_t frameCount;
@@ -84,14 +238,14 @@ private:
 
     // 内部方法
     void configurePins();
-    void waitForTransmitComplete();
+    void recordFrame(uint32_t now);
     bool validateChannel(uint16_t channel) const;  // 声明validateChannel函数
 
     // 禁用拷贝
     ESP32DMX(const ESP32DMX&) = delete;
     ESP32DMX& operator=(const ESP32DMX&) = delete;
 
-    // UART中断处理
-    static void IRAM_ATTR uartEventHandler(void *arg);
+    // UART事件任务(输入模式)
+    static void uartEventHandler(void *arg);
     void handleUARTEvent(uart_event_t& event);
 };
\ No newline at end of file
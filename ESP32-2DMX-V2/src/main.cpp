@@ -6,26 +6,28 @@
 #include <esp_task_wdt.h>
 #include <esp_system.h>
 #include "config.h"
-#include <Adafruit_NeoPixel.h>
 #include "dmx/ESP32DMX.h"
 #include "artnet/ArtnetNode.h"
+#include "sacn/E131Receiver.h"
 #include "rdm/RDMHandler.h"
 #include "pixels/PixelDriver.h"
 #include "web/WebServer.h"
 #include "ConfigManager.h"
 #include "GlobalConfig.h"
+#include "NodeMetrics.h"
 
 // 初始化常量
-#define INITIAL_PIXEL_COUNT 1
 #define TASK_STACK_SIZE 16384
 #define WDT_TIMEOUT 10
 #define WIFI_CONNECT_TIMEOUT 10000
 #define STATUS_CHECK_INTERVAL 10000
 #define HEAP_REPORT_INTERVAL 30000
+#define METRICS_SAMPLE_INTERVAL 1000
 
 // 全局变量
 WebServer* webServer = nullptr;
 ArtnetNode* artnetNode = nullptr;
+E131Receiver* sacnReceiver = nullptr;
 String apSSID = DEFAULT_AP_SSID;
 String apPassword = DEFAULT_AP_PASS;
 bool noWiFiMode = false;
@@ -36,8 +38,8 @@ ESP32DMX dmxB(2);  // UART2
 RDMHandler rdmHandler;
 PixelDriver pixelDriver;
 ConfigManager::Config config;
-Adafruit_NeoPixel pixels(INITIAL_PIXEL_COUNT, PIXEL_PIN, NEO_GRB + NEO_KHZ800);
 GlobalConfig gConfig;
+NodeMetrics gMetrics;
 
 // Task handles
 TaskHandle_t dmxTask = nullptr;
@@ -51,6 +53,7 @@ bool createTasks();
 bool startAPMode();
 void loadConfig();
 void validatePacket(uint8_t* dmxAData, uint8_t* dmxBData);
+uint16_t handleNodeRDM(const uint8_t* request, uint16_t length, const uint8_t** response);
 void stringToIP(const char* str, uint8_t* ip);
 
 // DMX处理任务
@@ -59,10 +62,12 @@ void dmxTaskFunction(void *parameter) {
     
     while (true) {
         esp_task_wdt_reset();
-        dmxA.update();
-        dmxB.update();
+
+        // 两个端口各自连续发送, 等待期间任务休眠
+        if (ESP32DMX::transmitPair(dmxA, dmxB) == 0) {
+            vTaskDelay(xDelay);
+        }
         rdmHandler.update();
-        vTaskDelay(xDelay);
     }
 }
 
@@ -74,6 +79,8 @@ void networkTaskFunction(void *parameter) {
         esp_task_wdt_reset();
         validatePacket(dmxA.getDMXData(), dmxB.getDMXData());
         if (artnetNode) artnetNode->update();
+        if (sacnReceiver) sacnReceiver->update();
+        if (config.pixelEnabled) pixelDriver.refresh();
         if (webServer) webServer->update();
         vTaskDelay(xDelay);
     }
@@ -83,6 +90,13 @@ void validatePacket(uint8_t* dmxAData, uint8_t* dmxBData) {
     // 数据包验证逻辑
 }
 
+// 发给本机UID的ArtRdm请求由本机响应器应答(如性能传感器)
+uint16_t handleNodeRDM(const uint8_t* request, uint16_t length, const uint8_t** response) {
+    uint16_t responseLength = rdmHandler.handleCommand(request, length);
+    *response = rdmHandler.getResponse();
+    return responseLength;
+}
+
 // WiFi事件处理
 void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
     Serial.printf("[WiFi-event] event: %d\n", event);
@@ -164,10 +178,6 @@ bool initializeSystem() {
         ConfigManager::save(config);
     }
 
-    // 更新NeoPixel配置
-    pixels.updateLength(config.pixelCount);
-    pixels.updateType(static_cast<neoPixelType>(config.pixelType));
-
     // 创建Art-Net节点
     artnetNode = new ArtnetNode();
     if (!artnetNode) {
@@ -223,17 +233,34 @@ bool setupNetwork() {
 }
 
 bool setupHardware() {
-    // 初始化DMX
-    dmxA.begin(DMX_TX_A_PIN, DMX_DIR_A_PIN);
-    dmxB.begin(DMX_TX_B_PIN, DMX_DIR_B_PIN);
-
-    // 配置Art-Net
-    ArtnetNode::Config artnetConfig = {
-        .net = config.artnetNet,
-        .subnet = config.artnetSubnet,
-        .universe = config.artnetUniverse,
-        .dmxStartAddress = config.dmxStartAddress
-    };
+    // 初始化DMX, 每个端口可配置为输出或输入
+    ESP32DMX* dmxPorts[2] = {&dmxA, &dmxB};
+    const gpio_num_t txPins[2] = {DMX_TX_A_PIN, DMX_TX_B_PIN};
+    const gpio_num_t rxPins[2] = {DMX_RX_A_PIN, DMX_RX_B_PIN};
+    const gpio_num_t dirPins[2] = {DMX_DIR_A_PIN, DMX_DIR_B_PIN};
+    for (int i = 0; i < 2; i++) {
+        if (config.dmxInput[i]) {
+            dmxPorts[i]->beginInput(rxPins[i], dirPins[i]);
+            continue;
+        }
+        dmxPorts[i]->begin(txPins[i], dirPins[i], rxPins[i]);
+        dmxPorts[i]->setSlotMode((DMXSlotMode)config.dmxSlotMode[i], config.dmxSlotCount[i]);
+        dmxPorts[i]->setRefreshRate(config.dmxRefreshRate[i]);
+        dmxPorts[i]->setRDMInterval(config.rdmInterval);
+        dmxPorts[i]->startOutput();
+    }
+
+    // 配置Art-Net, 在节点默认值(名称等)的基础上覆盖
+    ArtnetNode::Config artnetConfig = artnetNode->getConfig();
+    artnetConfig.net = config.artnetNet;
+    artnetConfig.subnet = config.artnetSubnet;
+    artnetConfig.universe = config.artnetUniverse;
+    artnetConfig.dmxMode = gConfig.dmxMode;
+    artnetConfig.dmxStartAddress = config.dmxStartAddress;
+    artnetConfig.pixelCount = config.pixelCount;
+    artnetConfig.pixelType = config.pixelType;
+    artnetConfig.mergeMode = config.mergeMode;
+    artnetConfig.rdmEnabled = config.rdmEnabled;
     artnetNode->setConfig(artnetConfig);
     
     if (!artnetNode->begin()) {
@@ -243,16 +270,50 @@ bool setupHardware() {
 
     // 初始化其他硬件
     if (config.pixelEnabled) {
-        pixels.begin();
-        pixels.setBrightness(config.brightness);
-        if (!pixelDriver.begin(PIXEL_PIN, PIXEL_COUNT)) {
+        // 各路输出按配置添加, 引脚和像素数未配置时使用默认值
+        static const gpio_num_t outputPins[PIXEL_MAX_OUTPUTS] = PIXEL_OUTPUT_PINS;
+        uint8_t outputCount = config.pixelOutputs > PIXEL_MAX_OUTPUTS ? PIXEL_MAX_OUTPUTS : config.pixelOutputs;
+        if (outputCount == 0) outputCount = 1;
+        // APA102 共用时钟引脚, 只支持单路输出
+        if (config.pixelType == TYPE_APA102 && outputCount > 1) {
+            Serial.println("APA102: Only One Pixel Output Supported");
+            outputCount = 1;
+        }
+        for (uint8_t i = 0; i < outputCount; i++) {
+            gpio_num_t pin = config.pixelPin[i] == 0xFF ? outputPins[i] : (gpio_num_t)config.pixelPin[i];
+            uint16_t length = config.pixelLength[i] ? config.pixelLength[i] : config.pixelCount;
+            pixelDriver.addOutput(pin, length, config.pixelUniverse[i]);
+        }
+        if (!pixelDriver.begin((PixelType)config.pixelType, PIXEL_CLOCK_PIN)) {
             Serial.println("Pixel Driver Init Failed");
             return false;
         }
+        pixelDriver.setDMXMode(true);
+        pixelDriver.setBrightness(config.brightness);
+        pixelDriver.setGamma(config.pixelGamma);
+        if (config.pixelDither && !pixelDriver.setDithering(true)) {
+            Serial.println("Pixel Dithering Disabled: Out of Memory");
+        }
+    }
+
+    // 绑定输出并按像素数量生成路由
+    if (!artnetNode->attachOutputs(&dmxA, &dmxB, config.pixelEnabled ? &pixelDriver : nullptr)) {
+        Serial.println("Art-Net Route Conflict: Check Pixel Universes");
+    }
+
+    // sACN与Art-Net共用路由表和输出
+    if (config.sacnEnabled) {
+        sacnReceiver = new E131Receiver(artnetNode);
+        if (!sacnReceiver->begin()) {
+            Serial.println("sACN Init Failed");
+            delete sacnReceiver;
+            sacnReceiver = nullptr;
+        }
     }
 
     if (config.rdmEnabled) {
-        rdmHandler.begin(&dmxA);
+        rdmHandler.begin();
+        artnetNode->setRDMCallback(handleNodeRDM);
     }
 
     return true;
@@ -330,15 +391,28 @@ void setup() {
 void loop() {
     static unsigned long lastCheck = 0;
     static unsigned long lastHeapReport = 0;
+    static unsigned long lastMetricsSample = 0;
     
     esp_task_wdt_reset();
 
+    // 性能指标采样, 供RDM传感器读取
+    if (millis() - lastMetricsSample >= METRICS_SAMPLE_INTERVAL) {
+        gMetrics.sample(dmxA.getFrameRate(), dmxB.getFrameRate());
+        lastMetricsSample = millis();
+    }
+
     // 系统状态报告
     if (millis() - lastHeapReport >= HEAP_REPORT_INTERVAL) {
         Serial.printf("Free Heap: %d, Max Block: %d\n", 
             ESP.getFreeHeap(), ESP.getMaxAllocHeap());
         Serial.printf("WiFi Status: %d, RSSI: %d\n", 
             WiFi.status(), WiFi.RSSI());
+        Serial.printf("DMX A: %u Hz, DMX B: %u Hz\n",
+            dmxA.getFrameRate(), dmxB.getFrameRate());
+        if (config.pixelEnabled) {
+            Serial.printf("Pixel ingest: %u us, show: %u us\n",
+                pixelDriver.getIngestTime(), gMetrics.pixelShowUs.load());
+        }
         lastHeapReport = millis();
     }
 
@@ -1,8 +1,29 @@
 #include "PixelDriver.h"
+#include "NodeMetrics.h"
+
+static_assert(PIXEL_MAX_OUTPUTS <= 4, "each pixel output needs its own RMT channel");
+
+// 输出序号即RMT通道号, 通道在编译期确定
+template<uint8_t CHANNEL>
+static PixelStrip* createRmtStrip(PixelType type, uint16_t count, gpio_num_t pin) {
+    switch (type) {
+        case TYPE_SK6812:
+            return new NeoGrbwStrip<CHANNEL>(count, pin);
+        case TYPE_WS2812_RGB:
+            return new NeoRgbStrip<CHANNEL>(count, pin);
+        case TYPE_WS2812_BRG:
+            return new NeoBrgStrip<CHANNEL>(count, pin);
+        case TYPE_WS2812:
+        default:
+            return new NeoGrbStrip<CHANNEL>(count, pin);
+    }
+}
 
 PixelDriver::PixelDriver()
-    : strip(nullptr)
+    : outputCount(0)
+    , segmentCount(0)
     , numPixels(0)
+    , clockPin(GPIO_NUM_NC)
     , enabled(false)
     , dmxMode(false)
     , currentEffect(EFFECT_NONE)
@@ -10,57 +31,181 @@ PixelDriver::PixelDriver()
     , effectStep(0)
     , lastUpdate(0)
     , brightness(255)
+    , gamma(1.0f)
+    , dithering(false)
+    , sourceFrame(nullptr)
+    , ingestFrame(nullptr)
+    , ditherError(nullptr)
+    , lastShow(0)
+    , wireTimeUs(0)
+    , ingestUs(0)
+    , lastIngestUs(0)
     , param1(0)
     , param2(0) {
+    memset(outputs, 0, sizeof(outputs));
+    memset(balance, 255, sizeof(balance));
+    buildColorLut();
+    setColorOrder(ORDER_RGB);
 }
 
 PixelDriver::~PixelDriver() {
-    if (strip) {
-        delete strip;
-        strip = nullptr;
+    releaseStrips();
+    releaseDitherBuffers();
+}
+
+// 各路像素依次排在全局索引中, 总数不超过 MAX_PIXELS
+bool PixelDriver::addOutput(gpio_num_t pin, uint16_t count, uint16_t universe) {
+    if (outputCount >= PIXEL_MAX_OUTPUTS || count == 0) {
+        return false;
+    }
+    if (count > MAX_PIXELS - numPixels) {
+        log_w("Pixel output %u truncated to %u pixels", outputCount, MAX_PIXELS - numPixels);
+        count = MAX_PIXELS - numPixels;
+        if (count == 0) return false;
     }
+
+    PixelOutput& output = outputs[outputCount++];
+    output.strip = nullptr;
+    output.pin = pin;
+    output.start = numPixels;
+    output.count = count;
+    output.universe = universe;
+    output.segments = 0;
+    numPixels += count;
+    return true;
 }
 
-bool PixelDriver::begin(gpio_num_t pin, uint16_t count, PixelType type) {
-    dataPin = pin;
-    numPixels = (count > MAX_PIXELS) ? MAX_PIXELS : count;
+// 单路输出
+bool PixelDriver::begin(gpio_num_t pin, uint16_t count, PixelType type, gpio_num_t clock) {
+    releaseStrips();
+    outputCount = 0;
+    numPixels = 0;
+    enabled = false;
+    addOutput(pin, count);
+    return begin(type, clock);
+}
+
+bool PixelDriver::begin(PixelType type, gpio_num_t clock) {
+    clockPin = clock;
     pixelType = type;
     
     // 创建并初始化LED控制对象
-    initializeStrip();
-    
-    if (!strip) {
+    if (!initializeStrips()) {
         return false;
     }
+
+    // RMT发送为异步, 线上时长按最长一路的数据量计算
+    uint8_t bytesPerPixel = type == TYPE_SK6812 ? 4 : 3;
+    wireTimeUs = 0;
+    for (uint8_t i = 0; i < outputCount; i++) {
+        uint32_t us = outputs[i].count * bytesPerPixel * PIXEL_BYTE_US + PIXEL_RESET_US;
+        if (us > wireTimeUs) wireTimeUs = us;
+    }
+
+    // 每路按宇宙切分, 最后一段可以不满
+    segmentCount = 0;
+    for (uint8_t i = 0; i < outputCount; i++) {
+        PixelOutput& output = outputs[i];
+        output.segments = 0;
+        for (uint16_t offset = 0; offset < output.count; offset += PIXELS_PER_UNIVERSE) {
+            PixelSegment& segment = segments[segmentCount++];
+            segment.output = i;
+            segment.start = output.start + offset;
+            segment.count = output.count - offset;
+            if (segment.count > PIXELS_PER_UNIVERSE) segment.count = PIXELS_PER_UNIVERSE;
+            output.segments++;
+        }
+        output.strip->begin();
+    }
     
-    strip->Begin();
     clear();
     show();
     
     enabled = true;
+    if (dithering) {
+        releaseDitherBuffers();
+        setDithering(true);
+    }
     return true;
 }
 
-void PixelDriver::initializeStrip() {
-    if (strip) {
-        delete strip;
+bool PixelDriver::initializeStrips() {
+    releaseStrips();
+    if (outputCount == 0) {
+        log_e("No pixel outputs configured");
+        return false;
+    }
+
+    for (uint8_t i = 0; i < outputCount; i++) {
+        outputs[i].strip = createStrip(i);
+        if (!outputs[i].strip) {
+            releaseStrips();
+            return false;
+        }
+    }
+    return true;
+}
+
+void PixelDriver::releaseStrips() {
+    for (uint8_t i = 0; i < outputCount; i++) {
+        delete outputs[i].strip;
+        outputs[i].strip = nullptr;
+    }
+}
+
+PixelStrip* PixelDriver::createStrip(uint8_t index) {
+    const PixelOutput& output = outputs[index];
+
+    // APA102 走SPI, 只支持一路
+    if (pixelType == TYPE_APA102) {
+        if (index > 0) {
+            log_e("APA102 supports a single output only");
+            return nullptr;
+        }
+        if (clockPin == GPIO_NUM_NC) {
+            log_e("APA102 requires a clock pin");
+            return nullptr;
+        }
+        return new DotStarStrip(output.count, clockPin, output.pin);
+    }
+
+    switch (index) {
+        case 0: return createRmtStrip<0>(pixelType, output.count, output.pin);
+        case 1: return createRmtStrip<1>(pixelType, output.count, output.pin);
+        case 2: return createRmtStrip<2>(pixelType, output.count, output.pin);
+        case 3: return createRmtStrip<3>(pixelType, output.count, output.pin);
+        default: return nullptr;
+    }
+}
+
+PixelOutput* PixelDriver::findOutput(uint16_t index) {
+    for (uint8_t i = 0; i < outputCount; i++) {
+        if (index < outputs[i].start + outputs[i].count) {
+            return &outputs[i];
+        }
+    }
+    return nullptr;
+}
+
+void PixelDriver::putPixel(uint16_t index, const RgbColor& color) {
+    PixelOutput* output = findOutput(index);
+    if (output) {
+        output->strip->setPixel(index - output->start, color);
     }
-    
-    strip = new PixelBus(numPixels, dataPin);
 }
 
 void PixelDriver::setPixel(uint16_t index, uint8_t r, uint8_t g, uint8_t b) {
     if (!enabled || !validatePixelIndex(index)) return;
     
     RgbColor color(r, g, b);
-    strip->SetPixelColor(index, applyBrightness(color));
+    putPixel(index, applyBrightness(color));
 }
 
 void PixelDriver::setPixelHSV(uint16_t index, float h, float s, float v) {
     if (!enabled || !validatePixelIndex(index)) return;
     
     RgbColor color = HSVtoRGB(h, s, v);
-    strip->SetPixelColor(index, applyBrightness(color));
+    putPixel(index, applyBrightness(color));
 }
 
 void PixelDriver::setRange(uint16_t start, uint16_t count, uint8_t r, uint8_t g, uint8_t b) {
@@ -73,12 +218,13 @@ void PixelDriver::setRange(uint16_t start, uint16_t count, uint8_t r, uint8_t g,
     if (end > numPixels) end = numPixels;
     
     for (uint16_t i = start; i < end; i++) {
-        strip->SetPixelColor(i, color);
+        putPixel(i, color);
     }
 }
 
 void PixelDriver::setBrightness(uint8_t value) {
     brightness = value;
+    buildColorLut();
     if (enabled && !dmxMode) {
         show();  // 立即更新显示
     }
@@ -87,30 +233,181 @@ void PixelDriver::setBrightness(uint8_t value) {
 void PixelDriver::clear() {
     if (!enabled) return;
     
-    for (uint16_t i = 0; i < numPixels; i++) {
-        strip->SetPixelColor(i, RgbColor(0));
+    for (uint8_t i = 0; i < outputCount; i++) {
+        outputs[i].strip->clear();
     }
 }
 
 void PixelDriver::show() {
     if (!enabled) return;
-    strip->Show();
+    if (dithering && dmxMode) {
+        // 同步或分段到齐后才锁存, 之后 refresh() 只重绘这一帧
+        memcpy(sourceFrame, ingestFrame, numPixels * 3);
+    }
+    present();
+    if (ingestUs) {
+        lastIngestUs = ingestUs;
+        ingestUs = 0;
+    }
+}
+
+void PixelDriver::present() {
+    if (dithering && dmxMode) {
+        renderDithered();
+    }
+    // 每路的 Show() 只启动RMT发送, 各路同时输出, 总耗时取决于最长的一路
+    uint32_t start = micros();
+    for (uint8_t i = 0; i < outputCount; i++) {
+        outputs[i].strip->show();
+    }
+    // APA102 同步发送, 直接计时; RMT的 Show() 只计到启动或等待上一帧, 改报线上时长
+    gMetrics.setPixelShow(pixelType == TYPE_APA102 ? micros() - start : wireTimeUs);
+    lastShow = millis();
+}
+
+void PixelDriver::refresh() {
+    if (!enabled || !dmxMode || !dithering) return;
+    if (millis() - lastShow < PIXEL_DITHER_INTERVAL) return;
+    for (uint8_t i = 0; i < outputCount; i++) {
+        if (!outputs[i].strip->canShow()) return;
+    }
+    present();
 }
 
 void PixelDriver::handleDMX(uint8_t* data, uint16_t length) {
     if (!enabled || !dmxMode || !data) return;
     
+    writeDMX(0, data, length);
+    show();
+}
+
+void PixelDriver::writeDMX(uint16_t startPixel, const uint8_t* data, uint16_t length) {
+    if (!enabled || !dmxMode || !data || startPixel >= numPixels) return;
+    
+    uint32_t start = micros();
     uint16_t pixelCount = length / 3;
-    if (pixelCount > numPixels) {
-        pixelCount = numPixels;
+    if (pixelCount > numPixels - startPixel) {
+        pixelCount = numPixels - startPixel;
     }
-    
-    for (uint16_t i = 0; i < pixelCount; i++) {
-        uint16_t base = i * 3;
-        setPixel(i, data[base], data[base + 1], data[base + 2]);
+
+    if (dithering) {
+        // 只保存重排后的原始值, show() 锁存后查表并抖动
+        const uint8_t sr = swizzle[0];
+        const uint8_t sg = swizzle[1];
+        const uint8_t sb = swizzle[2];
+        uint8_t* dest = ingestFrame + startPixel * 3;
+        for (uint16_t i = 0; i < pixelCount; i++) {
+            dest[0] = data[sr];
+            dest[1] = data[sg];
+            dest[2] = data[sb];
+            dest += 3;
+            data += 3;
+        }
+    } else {
+        // 直接写像素缓冲, 跳过逐像素的检查和 RgbColor 构造. 跨输出时分段写入
+        uint16_t pixel = startPixel;
+        while (pixelCount > 0) {
+            PixelOutput* output = findOutput(pixel);
+            uint16_t count = output->start + output->count - pixel;
+            if (count > pixelCount) count = pixelCount;
+            output->strip->writeRGB(pixel - output->start, data, count, swizzle, outputLut);
+            data += count * 3;
+            pixel += count;
+            pixelCount -= count;
+        }
     }
+    ingestUs += micros() - start;
+}
+
+void PixelDriver::writeSegment(uint8_t segment, const uint8_t* data, uint16_t length) {
+    if (segment >= segmentCount) return;
     
-    show();
+    const PixelSegment& target = segments[segment];
+    if (length > target.count * 3) {
+        length = target.count * 3;
+    }
+    writeDMX(target.start, data, length);
+}
+
+// 按输入通道顺序记录 R/G/B 所在的通道
+void PixelDriver::setColorOrder(PixelOrder order) {
+    // 每种顺序中 R/G/B 所在的通道
+    static const uint8_t positions[6][3] = {
+        {0, 1, 2},  // RGB
+        {0, 2, 1},  // RBG
+        {1, 0, 2},  // GRB
+        {2, 0, 1},  // GBR
+        {1, 2, 0},  // BRG
+        {2, 1, 0},  // BGR
+    };
+    if (order > ORDER_BGR) order = ORDER_RGB;
+    memcpy(swizzle, positions[order], sizeof(swizzle));
+}
+
+void PixelDriver::setGamma(float value) {
+    if (value < 0.1f || value > 5.0f) return;
+    gamma = value;
+    buildColorLut();
+}
+
+void PixelDriver::setColorBalance(uint8_t r, uint8_t g, uint8_t b) {
+    balance[0] = r;
+    balance[1] = g;
+    balance[2] = b;
+    buildColorLut();
+}
+
+// 伽马/亮度/白平衡合成一张表, 浮点运算只在重建时进行
+void PixelDriver::buildColorLut() {
+    for (uint8_t c = 0; c < 3; c++) {
+        float scale = (brightness / 255.0f) * (balance[c] / 255.0f) * 255.0f * 256.0f;
+        for (uint16_t i = 0; i < 256; i++) {
+            float level = gamma == 1.0f ? i / 255.0f : powf(i / 255.0f, gamma);
+            uint32_t value = (uint32_t)(level * scale + 0.5f);
+            if (value > 0xFF00) value = 0xFF00;
+            colorLut[c][i] = value;
+            outputLut[c][i] = (value + 0x80) >> 8;
+        }
+    }
+}
+
+// 抖动开启时分配保持帧和误差缓冲, 内存不足时保持关闭
+bool PixelDriver::setDithering(bool enable) {
+    dithering = enable;
+    if (!enable) {
+        releaseDitherBuffers();
+        return true;
+    }
+    if (sourceFrame || numPixels == 0) {
+        return true;  // 已分配, 或在 begin() 时分配
+    }
+
+    sourceFrame = (uint8_t*)calloc(numPixels, 3);
+    ingestFrame = (uint8_t*)calloc(numPixels, 3);
+    ditherError = (uint8_t*)calloc(numPixels, 3);
+    if (!sourceFrame || !ingestFrame || !ditherError) {
+        releaseDitherBuffers();
+        dithering = false;
+        return false;
+    }
+    return true;
+}
+
+void PixelDriver::releaseDitherBuffers() {
+    free(sourceFrame);
+    free(ingestFrame);
+    free(ditherError);
+    sourceFrame = nullptr;
+    ingestFrame = nullptr;
+    ditherError = nullptr;
+}
+
+void PixelDriver::renderDithered() {
+    for (uint8_t i = 0; i < outputCount; i++) {
+        const PixelOutput& output = outputs[i];
+        output.strip->writeDithered(sourceFrame + output.start * 3, ditherError + output.start * 3,
+                                    output.count, colorLut);
+    }
 }
 
 void PixelDriver::update() {
@@ -175,7 +472,7 @@ void PixelDriver::updateFade() {
     ));
     
     for (uint16_t i = 0; i < numPixels; i++) {
-        strip->SetPixelColor(i, color);
+        putPixel(i, color);
     }
     
     effectStep = (effectStep + 1) & 0xFF;
@@ -225,12 +522,7 @@ RgbColor PixelDriver::HSVtoRGB(float h, float s, float v) {
 }
 
 RgbColor PixelDriver::applyBrightness(const RgbColor& color) {
-    if (brightness == 255) return color;
-    return RgbColor(
-        (color.R * brightness) >> 8,
-        (color.G * brightness) >> 8,
-        (color.B * brightness) >> 8
-    );
+    return RgbColor(outputLut[0][color.R], outputLut[1][color.G], outputLut[2][color.B]);
 }
 
 bool PixelDriver::validatePixelIndex(uint16_t index) const {
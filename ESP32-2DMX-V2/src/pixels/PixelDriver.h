@@ -3,12 +3,29 @@
 #include <Arduino.h>
 #include <NeoPixelBus.h>
 #include "config.h"
+#include "PixelStrip.h"
+
+#define PIXEL_DITHER_INTERVAL 4  // 抖动开启时保持帧的最短重绘间隔(ms)
+#define PIXEL_BYTE_US 10         // 800kbps 灯带每字节的线上时间(us)
+#define PIXEL_RESET_US 300       // 帧尾复位时间(us)
 
 // 像素类型定义
 enum PixelType {
-    TYPE_WS2812 = 0,
-    TYPE_SK6812 = 1,
-    TYPE_APA102 = 2
+    TYPE_WS2812 = 0,        // GRB
+    TYPE_SK6812 = 1,        // GRBW, W通道保持为0
+    TYPE_APA102 = 2,        // 需要时钟引脚
+    TYPE_WS2812_RGB = 3,
+    TYPE_WS2812_BRG = 4
+};
+
+// DMX数据中的颜色通道顺序
+enum PixelOrder {
+    ORDER_RGB = 0,
+    ORDER_RBG = 1,
+    ORDER_GRB = 2,
+    ORDER_GBR = 3,
+    ORDER_BRG = 4,
+    ORDER_BGR = 5
 };
 
 // 效果类型定义
@@ -21,13 +38,34 @@ enum PixelEffect {
     EFFECT_FIRE = 5
 };
 
+// 一路像素输出, 占用全局像素索引 [start, start + count)
+struct PixelOutput {
+    PixelStrip* strip;
+    gpio_num_t pin;
+    uint16_t start;
+    uint16_t count;
+    uint16_t universe;   // 起始宇宙, PIXEL_UNIVERSE_AUTO 表示接在前一路之后
+    uint8_t segments;    // 占用的宇宙数
+};
+
+// 一个宇宙对应的像素段, 不跨输出
+struct PixelSegment {
+    uint8_t output;
+    uint16_t start;      // 全局像素索引
+    uint16_t count;
+};
+
 class PixelDriver {
 public:
     PixelDriver();
     ~PixelDriver();
 
     // 基本功能
-    bool begin(gpio_num_t pin, uint16_t numPixels, PixelType type = TYPE_WS2812);
+    // 多路输出: 先逐路 addOutput(), 再 begin(). 各路使用独立RMT通道并行刷新
+    bool addOutput(gpio_num_t pin, uint16_t count, uint16_t universe = PIXEL_UNIVERSE_AUTO);
+    bool begin(PixelType type = TYPE_WS2812, gpio_num_t clockPin = GPIO_NUM_NC);
+    bool begin(gpio_num_t pin, uint16_t numPixels, PixelType type = TYPE_WS2812,
+               gpio_num_t clockPin = GPIO_NUM_NC);
     void update();
     void show();
     void clear();
@@ -37,6 +75,13 @@ public:
     void setPixelHSV(uint16_t index, float h, float s, float v);
     void setRange(uint16_t start, uint16_t count, uint8_t r, uint8_t g, uint8_t b);
     void setBrightness(uint8_t brightness);
+    // 伽马与白平衡, 和亮度一起预先算入查找表, 修改时才重建.
+    // 各路输出共用一套查找表: 每路一套需多占约2.3KB, 目前配置也只有全局的伽马与亮度
+    void setGamma(float gamma);
+    void setColorBalance(uint8_t r, uint8_t g, uint8_t b);
+    // 时间抖动: 查找表的小数部分逐帧累积, 低亮度渐变不再出现台阶
+    bool setDithering(bool enable);
+    void refresh();  // 抖动开启时在网络任务中调用, 按灯带刷新率重绘保持的帧
     
     // 效果控制
     void setEffect(PixelEffect effect);
@@ -46,21 +91,31 @@ public:
     
     // DMX控制
     void handleDMX(uint8_t* data, uint16_t length);
+    // 写入但不刷新: 连续RGB数据一次写入像素缓冲, 通道重排和亮度查表同时完成
+    void writeDMX(uint16_t startPixel, const uint8_t* data, uint16_t length);
+    void writeSegment(uint8_t segment, const uint8_t* data, uint16_t length);
     void setDMXMode(bool enabled) { dmxMode = enabled; }
+    void setColorOrder(PixelOrder order);
+    uint32_t getIngestTime() const { return lastIngestUs; }  // 上一帧写入像素缓冲的总耗时(us)
     
     // 状态查询
     uint16_t getNumPixels() const { return numPixels; }
+    uint8_t getOutputCount() const { return outputCount; }
+    const PixelOutput& getOutput(uint8_t index) const { return outputs[index]; }
+    uint8_t getSegmentCount() const { return segmentCount; }
     bool isEnabled() const { return enabled; }
     PixelEffect getCurrentEffect() const { return currentEffect; }
 
 private:
-    // NeoPixelBus对象
-    using PixelBus = NeoPixelBus<NeoGrbFeature, Neo800KbpsMethod>;
-    PixelBus* strip;
+    // 各路输出及按宇宙划分的像素段, 段按输出顺序排列
+    PixelOutput outputs[PIXEL_MAX_OUTPUTS];
+    uint8_t outputCount;
+    PixelSegment segments[PIXEL_MAX_SEGMENTS];
+    uint8_t segmentCount;
     
     // 配置参数
     uint16_t numPixels;
-    gpio_num_t dataPin;
+    gpio_num_t clockPin;
     PixelType pixelType;
     bool enabled;
     bool dmxMode;
@@ -72,6 +127,19 @@ private:
     uint32_t lastUpdate;
     RgbColor effectColor;
     uint8_t brightness;
+    float gamma;
+    uint8_t balance[3];         // R/G/B 白平衡
+    uint16_t colorLut[3][256];  // R/G/B 8.8定点输出: 高8位为整数, 低8位为抖动用的小数
+    uint8_t outputLut[3][256];  // 四舍五入后的8位输出, 不抖动时使用
+    uint8_t swizzle[3];         // R/G/B 在DMX数据中的偏移
+    bool dithering;
+    uint8_t* sourceFrame;       // 抖动时保持的已锁存帧(已按R/G/B重排, 未查表)
+    uint8_t* ingestFrame;       // 正在写入的帧, show() 时才锁存到 sourceFrame
+    uint8_t* ditherError;       // 每个子像素累积的小数误差
+    uint32_t lastShow;
+    uint32_t wireTimeUs;        // RMT输出一帧的线上时长, 取最长的一路
+    uint32_t ingestUs;          // 本帧累计写入耗时
+    uint32_t lastIngestUs;
     uint8_t param1;
     uint8_t param2;
     
@@ -86,8 +154,16 @@ private:
     // 颜色转换
     RgbColor HSVtoRGB(float h, float s, float v);
     RgbColor applyBrightness(const RgbColor& color);
+    void buildColorLut();
+    void renderDithered();
+    void present();
+    void releaseDitherBuffers();
     
     // 帮助方法
     bool validatePixelIndex(uint16_t index) const;
-    void initializeStrip();
+    bool initializeStrips();
+    void releaseStrips();
+    PixelStrip* createStrip(uint8_t output);
+    PixelOutput* findOutput(uint16_t index);
+    void putPixel(uint16_t index, const RgbColor& color);
 };
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <Arduino.h>
+#include <NeoPixelBus.h>
+
+// 灯带接口: 虚函数每帧只调用一次, 逐像素循环在下面的模板实现中展开.
+// 颜色数据和查找表均按 R/G/B 排列, 由实现映射到各芯片的字节顺序
+class PixelStrip {
+public:
+    virtual ~PixelStrip() {}
+
+    virtual void begin() = 0;
+    virtual void show() = 0;
+    virtual bool canShow() const = 0;
+    virtual void clear() = 0;
+    virtual void setPixel(uint16_t index, const RgbColor& color) = 0;
+
+    // data 为连续的输入像素(每像素3字节), swizzle 为 R/G/B 在输入中的偏移
+    virtual void writeRGB(uint16_t start, const uint8_t* data, uint16_t count,
+                          const uint8_t* swizzle, const uint8_t (*lut)[256]) = 0;
+    // source 为按 R/G/B 保存的整帧, error 为各子像素的小数误差
+    virtual void writeDithered(const uint8_t* source, uint8_t* error, uint16_t count,
+                               const uint16_t (*lut)[256]) = 0;
+};
+
+// BYTES 为每像素字节数, R_POS/G_POS/B_POS 为颜色在像素内的字节位置.
+// RGBW的W字节和APA102的亮度帧头由 clear() 初始化, 写入时不再改动
+template<typename T_FEATURE, typename T_METHOD, uint8_t BYTES, uint8_t R_POS, uint8_t G_POS, uint8_t B_POS>
+class NeoStrip : public PixelStrip {
+public:
+    NeoStrip(uint16_t count, uint8_t pin) : bus(count, pin) {}
+    NeoStrip(uint16_t count, uint8_t clockPin, uint8_t dataPin) : bus(count, clockPin, dataPin) {}
+
+    void begin() override {
+        bus.Begin();
+        bus.ClearTo(RgbColor(0));
+    }
+
+    void show() override { bus.Show(); }
+    bool canShow() const override { return bus.CanShow(); }
+    void clear() override { bus.ClearTo(RgbColor(0)); }
+    void setPixel(uint16_t index, const RgbColor& color) override { bus.SetPixelColor(index, color); }
+
+    void writeRGB(uint16_t start, const uint8_t* data, uint16_t count,
+                  const uint8_t* swizzle, const uint8_t (*lut)[256]) override {
+        uint8_t* dest = bus.Pixels() + start * BYTES;
+        const uint8_t sr = swizzle[0];
+        const uint8_t sg = swizzle[1];
+        const uint8_t sb = swizzle[2];
+        for (uint16_t i = 0; i < count; i++) {
+            dest[R_POS] = lut[0][data[sr]];
+            dest[G_POS] = lut[1][data[sg]];
+            dest[B_POS] = lut[2][data[sb]];
+            dest += BYTES;
+            data += 3;
+        }
+        bus.Dirty();
+    }
+
+    // 查表值加上一帧留下的小数误差, 整数部分输出, 余下的小数留给下一帧
+    void writeDithered(const uint8_t* source, uint8_t* error, uint16_t count,
+                       const uint16_t (*lut)[256]) override {
+        uint8_t* dest = bus.Pixels();
+        for (uint16_t i = 0; i < count; i++) {
+            uint16_t r = lut[0][source[0]] + error[0];
+            uint16_t g = lut[1][source[1]] + error[1];
+            uint16_t b = lut[2][source[2]] + error[2];
+            dest[R_POS] = r >> 8;
+            dest[G_POS] = g >> 8;
+            dest[B_POS] = b >> 8;
+            error[0] = r & 0xFF;
+            error[1] = g & 0xFF;
+            error[2] = b & 0xFF;
+            dest += BYTES;
+            source += 3;
+            error += 3;
+        }
+        bus.Dirty();
+    }
+
+private:
+    NeoPixelBus<T_FEATURE, T_METHOD> bus;
+};
+
+// 每路输出使用独立的RMT通道, 各路 Show() 启动后由硬件并行发送
+template<uint8_t CHANNEL> struct RmtMethod;
+template<> struct RmtMethod<0> { typedef NeoEsp32Rmt0Ws2812xMethod Ws2812x; typedef NeoEsp32Rmt0Sk6812Method Sk6812; };
+template<> struct RmtMethod<1> { typedef NeoEsp32Rmt1Ws2812xMethod Ws2812x; typedef NeoEsp32Rmt1Sk6812Method Sk6812; };
+template<> struct RmtMethod<2> { typedef NeoEsp32Rmt2Ws2812xMethod Ws2812x; typedef NeoEsp32Rmt2Sk6812Method Sk6812; };
+template<> struct RmtMethod<3> { typedef NeoEsp32Rmt3Ws2812xMethod Ws2812x; typedef NeoEsp32Rmt3Sk6812Method Sk6812; };
+
+// 支持的灯带类型, CHANNEL 为RMT通道
+template<uint8_t CHANNEL>
+using NeoGrbStrip = NeoStrip<NeoGrbFeature, typename RmtMethod<CHANNEL>::Ws2812x, 3, 1, 0, 2>;     // WS2812
+template<uint8_t CHANNEL>
+using NeoRgbStrip = NeoStrip<NeoRgbFeature, typename RmtMethod<CHANNEL>::Ws2812x, 3, 0, 1, 2>;
+template<uint8_t CHANNEL>
+using NeoBrgStrip = NeoStrip<NeoBrgFeature, typename RmtMethod<CHANNEL>::Ws2812x, 3, 1, 2, 0>;
+template<uint8_t CHANNEL>
+using NeoGrbwStrip = NeoStrip<NeoGrbwFeature, typename RmtMethod<CHANNEL>::Sk6812, 4, 1, 0, 2>;   // SK6812 RGBW
+typedef NeoStrip<DotStarBgrFeature, DotStarMethod, 4, 3, 2, 1> DotStarStrip;  // APA102, 首字节为亮度帧头
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// RDM报文字段偏移(含起始码0xCC), 多字节字段均为大端
+#define RDM_OFFSET_LENGTH 2
+#define RDM_OFFSET_DEST 3
+#define RDM_OFFSET_SOURCE 9
+#define RDM_OFFSET_TN 15
+#define RDM_OFFSET_PORT 16
+#define RDM_OFFSET_MSG_COUNT 17
+#define RDM_OFFSET_SUB_DEVICE 18
+#define RDM_OFFSET_CC 20
+#define RDM_OFFSET_PID 21
+#define RDM_OFFSET_PDL 23
+#define RDM_HEADER_SIZE 24
+#define RDM_MAX_PDL 231
+
+inline uint16_t rdmRead16(const uint8_t* p) {
+    return (p[0] << 8) | p[1];
+}
+
+inline void rdmWrite16(uint8_t* p, uint16_t value) {
+    p[0] = value >> 8;
+    p[1] = value & 0xFF;
+}
+
+// 校验和: 起始码到参数数据末尾的字节和
+inline uint16_t rdmChecksum(const uint8_t* data, uint16_t length) {
+    uint16_t sum = 0;
+    for (uint16_t i = 0; i < length; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+// 检查报文头和校验和, length 为收到的总字节数
+inline bool rdmValidate(const uint8_t* data, uint16_t length) {
+    if (length < RDM_HEADER_SIZE + 2 || data[0] != 0xCC || data[1] != 0x01) {
+        return false;
+    }
+    uint8_t messageLength = data[RDM_OFFSET_LENGTH];
+    if (messageLength < RDM_HEADER_SIZE || length < messageLength + 2 ||
+        data[RDM_OFFSET_PDL] != messageLength - RDM_HEADER_SIZE) {
+        return false;
+    }
+    return rdmChecksum(data, messageLength) == rdmRead16(data + messageLength);
+}
+
+// 参数数据读取: 直接在接收缓冲上按大端解码, 越界时置错误标志
+class RDMReader {
+public:
+    RDMReader(const uint8_t* data, uint8_t length)
+        : data(data), length(length), pos(0), error(false) {}
+
+    uint8_t size() const { return length; }
+    uint8_t remaining() const { return length - pos; }
+    bool ok() const { return !error; }
+
+    uint8_t readU8() {
+        if (!take(1)) return 0;
+        return data[pos - 1];
+    }
+
+    uint16_t readU16() {
+        if (!take(2)) return 0;
+        return rdmRead16(data + pos - 2);
+    }
+
+    uint32_t readU32() {
+        if (!take(4)) return 0;
+        const uint8_t* p = data + pos - 4;
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | (p[2] << 8) | p[3];
+    }
+
+    const uint8_t* readBytes(uint8_t count) {
+        if (!take(count)) return nullptr;
+        return data + pos - count;
+    }
+
+private:
+    const uint8_t* data;
+    uint8_t length;
+    uint8_t pos;
+    bool error;
+
+    bool take(uint8_t count) {
+        if (error || remaining() < count) {
+            error = true;
+            return false;
+        }
+        pos += count;
+        return true;
+    }
+};
+
+// 响应组帧: 参数数据直接写入预分配帧的数据区,
+// finish() 一次填好长度字段并追加校验和
+class RDMWriter {
+public:
+    explicit RDMWriter(uint8_t* frame)
+        : frame(frame), pos(RDM_HEADER_SIZE), error(false) {}
+
+    uint8_t* header() { return frame; }
+    uint8_t length() const { return pos - RDM_HEADER_SIZE; }
+    bool ok() const { return !error; }
+
+    void writeU8(uint8_t value) {
+        if (reserve(1)) frame[pos++] = value;
+    }
+
+    void writeU16(uint16_t value) {
+        if (!reserve(2)) return;
+        rdmWrite16(frame + pos, value);
+        pos += 2;
+    }
+
+    void writeU32(uint32_t value) {
+        if (!reserve(4)) return;
+        frame[pos++] = value >> 24;
+        frame[pos++] = (value >> 16) & 0xFF;
+        frame[pos++] = (value >> 8) & 0xFF;
+        frame[pos++] = value & 0xFF;
+    }
+
+    void writeBytes(const uint8_t* data, uint8_t count) {
+        if (!reserve(count)) return;
+        memcpy(frame + pos, data, count);
+        pos += count;
+    }
+
+    // RDM文本不带结束符, 最长32字节
+    void writeString(const char* text, uint8_t maxLength = 32) {
+        uint8_t count = strnlen(text, maxLength);
+        writeBytes((const uint8_t*)text, count);
+    }
+
+    // 丢弃已写入的参数数据(如改为NACK)
+    void reset() {
+        pos = RDM_HEADER_SIZE;
+        error = false;
+    }
+
+    // 填写消息长度和PDL并追加校验和, 返回含校验和的总长度
+    uint16_t finish() {
+        frame[RDM_OFFSET_LENGTH] = pos;
+        frame[RDM_OFFSET_PDL] = pos - RDM_HEADER_SIZE;
+        rdmWrite16(frame + pos, rdmChecksum(frame, pos));
+        return pos + 2;
+    }
+
+private:
+    uint8_t* frame;
+    uint16_t pos;
+    bool error;
+
+    bool reserve(uint8_t count) {
+        if (error || pos + count > RDM_HEADER_SIZE + RDM_MAX_PDL) {
+            error = true;
+            return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,273 @@
+#include "RDMDiscovery.h"
+
+#define RDM_BROADCAST_UID 0xFFFFFFFFFFFFULL
+#define RDM_MAX_UID 0xFFFFFFFFFFFEULL
+
+RDMDiscovery::RDMDiscovery()
+    : dmx(nullptr)
+    , tod(nullptr)
+    , state(STATE_IDLE)
+    , waiting(false)
+    , restartPending(false)
+    , restartFull(false)
+    , incremental(true)
+    , changed(false)
+    , lastRun(0)
+    , transactionNumber(0)
+    , verifyIndex(0)
+    , candidate(0)
+    , depth(0)
+    , collisions(0) {
+    memset(&source, 0, sizeof(source));
+}
+
+void RDMDiscovery::begin(ESP32DMX* dmx, RDMTod* tod, const RDMUID& controllerUid) {
+    this->dmx = dmx;
+    this->tod = tod;
+    source = controllerUid;
+    start(true);
+}
+
+void RDMDiscovery::start(bool full) {
+    if (!dmx || !tod) return;
+
+    // 旧事务的结果不能套用到新的状态机上
+    if (waiting) {
+        restartFull = restartPending ? (restartFull || full) : full;
+        restartPending = true;
+        return;
+    }
+
+    if (full) {
+        if (tod->count()) changed = true;
+        tod->clear();
+        state = STATE_UNMUTE;
+    } else {
+        state = STATE_VERIFY;
+        verifyIndex = 0;
+    }
+    stack[0].lower = 0;
+    stack[0].upper = RDM_MAX_UID;
+    depth = 1;
+}
+
+void RDMDiscovery::stop() {
+    restartPending = false;
+    state = STATE_IDLE;
+    depth = 0;
+    lastRun = millis();
+}
+
+bool RDMDiscovery::takeChanged() {
+    bool result = changed;
+    changed = false;
+    return result;
+}
+
+void RDMDiscovery::update() {
+    if (!dmx || waiting) return;
+
+    if (state == STATE_IDLE) {
+        if (!incremental || millis() - lastRun < RDM_DISCOVERY_INTERVAL) return;
+        start(false);
+    }
+
+    uint8_t bounds[12];
+    switch (state) {
+        case STATE_UNMUTE:
+            waiting = sendCommand(RDM_BROADCAST_UID, PARAM_DISC_UN_MUTE, nullptr, 0);
+            break;
+
+        case STATE_VERIFY:
+            if (verifyIndex >= tod->count()) {
+                state = STATE_BRANCH;
+                update();
+                return;
+            }
+            waiting = sendCommand(toUid(tod->get(verifyIndex).id), PARAM_DISC_MUTE, nullptr, 0);
+            break;
+
+        case STATE_BRANCH:
+            if (depth == 0) {
+                stop();
+                return;
+            }
+            fromUid(stack[depth - 1].lower, bounds);
+            fromUid(stack[depth - 1].upper, bounds + 6);
+            waiting = sendCommand(RDM_BROADCAST_UID, PARAM_DISC_UNIQUE_BRANCH, bounds, sizeof(bounds));
+            break;
+
+        case STATE_MUTE:
+            waiting = sendCommand(candidate, PARAM_DISC_MUTE, nullptr, 0);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void RDMDiscovery::handleResult(const RDMTransaction& result) {
+    waiting = false;
+    if (restartPending) {
+        restartPending = false;
+        start(restartFull);
+        return;
+    }
+
+    switch (state) {
+        case STATE_UNMUTE:
+            state = STATE_BRANCH;
+            break;
+
+        case STATE_VERIFY: {
+            uint64_t uid = toUid(tod->get(verifyIndex).id);
+            if (isMuteResponse(result, uid)) {
+                verifyIndex++;
+            } else {
+                // 设备已离线, 末项移入当前位置
+                tod->remove(tod->get(verifyIndex).id);
+                changed = true;
+            }
+            break;
+        }
+
+        case STATE_BRANCH: {
+            if (result.status != RDM_STATUS_OK) {
+                popRange();  // 区间内没有未静音的设备
+                break;
+            }
+            uint64_t uid;
+            Range range = stack[depth - 1];
+            if (decodeBranchResponse(result, uid) && uid >= range.lower && uid <= range.upper) {
+                uint8_t bytes[RDM_UID_LENGTH];
+                fromUid(uid, bytes);
+                if (tod->contains(bytes)) {
+                    popRange();  // 已静音的设备仍然应答, 放弃该区间以免死循环
+                } else {
+                    candidate = uid;
+                    state = STATE_MUTE;
+                }
+                break;
+            }
+
+            // 冲突: 区间内有多个设备, 二分后先查下半区
+            collisions++;
+            popRange();
+            if (range.lower < range.upper) {
+                uint64_t mid = range.lower + (range.upper - range.lower) / 2;
+                stack[depth].lower = mid + 1;
+                stack[depth].upper = range.upper;
+                depth++;
+                stack[depth].lower = range.lower;
+                stack[depth].upper = mid;
+                depth++;
+            }
+            break;
+        }
+
+        case STATE_MUTE:
+            if (isMuteResponse(result, candidate)) {
+                uint8_t bytes[RDM_UID_LENGTH];
+                fromUid(candidate, bytes);
+                if (tod->add(bytes)) {
+                    changed = true;
+                }
+            } else {
+                popRange();  // 无法静音, 放弃该区间
+            }
+            // 静音成功后重查同一区间, 可能还有其他设备
+            state = STATE_BRANCH;
+            break;
+
+        default:
+            break;
+    }
+}
+
+void RDMDiscovery::popRange() {
+    if (depth) depth--;
+}
+
+// 组装发现命令并排队
+bool RDMDiscovery::sendCommand(uint64_t dest, uint16_t pid, const uint8_t* data, uint8_t length) {
+    uint8_t packet[26 + 12];
+    uint8_t messageLength = 24 + length;
+
+    packet[0] = 0xCC;
+    packet[1] = RDM_SUB_START_CODE;
+    packet[2] = messageLength;
+    fromUid(dest, &packet[3]);
+    memcpy(&packet[9], source.id, RDM_UID_LENGTH);
+    packet[15] = transactionNumber;
+    packet[16] = 0x01;               // 端口号
+    packet[17] = 0x00;               // 消息计数
+    packet[18] = 0x00;               // 子设备
+    packet[19] = 0x00;
+    packet[20] = RDM_DISCOVERY_COMMAND;
+    packet[21] = pid >> 8;
+    packet[22] = pid & 0xFF;
+    packet[23] = length;
+    if (length) {
+        memcpy(&packet[24], data, length);
+    }
+
+    rdmWrite16(&packet[messageLength], rdmChecksum(packet, messageLength));
+
+    if (!dmx->queueRDM(packet, messageLength + 2, RDM_TAG_DISCOVERY)) {
+        return false;
+    }
+    transactionNumber++;
+    return true;
+}
+
+// DISC_MUTE 应答: 发现命令应答, 源UID为目标设备, 校验和正确
+bool RDMDiscovery::isMuteResponse(const RDMTransaction& result, uint64_t uid) const {
+    const uint8_t* data = result.data;
+    return result.status == RDM_STATUS_OK && rdmValidate(data, result.length) &&
+           data[RDM_OFFSET_CC] == RDM_DISCOVERY_RESPONSE &&
+           rdmRead16(&data[RDM_OFFSET_PID]) == PARAM_DISC_MUTE &&
+           toUid(&data[RDM_OFFSET_SOURCE]) == uid;
+}
+
+// DUB应答: 0~7字节0xFE前导码, 0xAA分隔符, 12字节编码UID, 4字节编码校验和.
+// 每个字节拆成 (b|0xAA) 和 (b|0x55) 两字节, 冲突时校验和不符
+bool RDMDiscovery::decodeBranchResponse(const RDMTransaction& result, uint64_t& uid) const {
+    const uint8_t* data = result.data;
+    uint16_t start = 0;
+    while (start < result.length && start < 7 && data[start] == 0xFE) start++;
+    if (start >= result.length || data[start] != 0xAA || result.length < start + 17) {
+        return false;
+    }
+
+    const uint8_t* encoded = &data[start + 1];
+    uint8_t bytes[RDM_UID_LENGTH];
+    uint16_t sum = 0;
+    for (uint8_t i = 0; i < 12; i++) {
+        sum += encoded[i];
+    }
+    for (uint8_t i = 0; i < RDM_UID_LENGTH; i++) {
+        bytes[i] = encoded[i * 2] & encoded[i * 2 + 1];
+    }
+    uint16_t checksum = ((encoded[12] & encoded[13]) << 8) | (encoded[14] & encoded[15]);
+    if (checksum != sum) {
+        return false;
+    }
+
+    uid = toUid(bytes);
+    return true;
+}
+
+uint64_t RDMDiscovery::toUid(const uint8_t* bytes) {
+    uint64_t uid = 0;
+    for (uint8_t i = 0; i < RDM_UID_LENGTH; i++) {
+        uid = (uid << 8) | bytes[i];
+    }
+    return uid;
+}
+
+void RDMDiscovery::fromUid(uint64_t uid, uint8_t* bytes) {
+    for (int8_t i = RDM_UID_LENGTH - 1; i >= 0; i--) {
+        bytes[i] = uid & 0xFF;
+        uid >>= 8;
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Arduino.h>
+#include "ESP32DMX.h"
+#include "RDMTod.h"
+
+#define RDM_TAG_DISCOVERY 0            // 发现事务的标记, 与Art-Net请求方IP区分
+#define RDM_DISCOVERY_INTERVAL 60000   // 后台增量发现间隔(ms)
+#define RDM_DISCOVERY_MAX_DEPTH 49     // 48位UID二分查找的最大栈深
+
+#define PARAM_DISC_UNIQUE_BRANCH 0x0001
+#define PARAM_DISC_MUTE 0x0002
+#define PARAM_DISC_UN_MUTE 0x0003
+
+// 控制器侧RDM发现: DISC_UNIQUE_BRANCH 二分查找.
+// 每次只排队一个事务, 经由 ESP32DMX 的RDM队列与DMX帧交替发送;
+// 结果(标记为 RDM_TAG_DISCOVERY)由取回队列结果的任务交给 handleResult
+class RDMDiscovery {
+public:
+    RDMDiscovery();
+
+    void begin(ESP32DMX* dmx, RDMTod* tod, const RDMUID& controllerUid);
+    void start(bool full);   // full: 清空设备表并解除所有设备静音. 有事务未完成时推迟到其结果返回
+    void stop();
+    void update();           // 发出下一步请求, 空闲时按间隔启动增量发现
+    void handleResult(const RDMTransaction& result);
+
+    void setIncremental(bool enable) { incremental = enable; }
+    bool isRunning() const { return state != STATE_IDLE; }
+    bool takeChanged();      // 设备表自上次查询后是否变化
+    uint32_t getCollisions() const { return collisions; }
+
+private:
+    enum State : uint8_t {
+        STATE_IDLE,
+        STATE_UNMUTE,    // 广播解除静音(完整发现)
+        STATE_VERIFY,    // 逐个静音已知设备, 无应答的移出设备表(增量发现)
+        STATE_BRANCH,    // 对栈顶区间发送DUB
+        STATE_MUTE       // 静音刚找到的设备
+    };
+
+    struct Range {
+        uint64_t lower;
+        uint64_t upper;
+    };
+
+    ESP32DMX* dmx;
+    RDMTod* tod;
+    RDMUID source;
+    State state;
+    bool waiting;            // 有事务在队列中
+    bool restartPending;     // 事务未完成时收到的 start(), 结果返回后丢弃结果再重启
+    bool restartFull;
+    bool incremental;
+    bool changed;
+    uint32_t lastRun;
+    uint8_t transactionNumber;
+    uint16_t verifyIndex;
+    uint64_t candidate;
+    Range stack[RDM_DISCOVERY_MAX_DEPTH];
+    uint8_t depth;
+    uint32_t collisions;
+
+    bool sendCommand(uint64_t dest, uint16_t pid, const uint8_t* data, uint8_t length);
+    bool isMuteResponse(const RDMTransaction& result, uint64_t uid) const;
+    bool decodeBranchResponse(const RDMTransaction& result, uint64_t& uid) const;
+    void popRange();
+
+    static uint64_t toUid(const uint8_t* bytes);
+    static void fromUid(uint64_t uid, uint8_t* bytes);
+};
@@ -1,13 +1,68 @@
 #include "RDMHandler.h"
 #include <esp_random.h>
 #include <WiFi.h>
+#include "config.h"
+#include "NodeMetrics.h"
+
+// 传感器定义, 按 MetricSensor 顺序
+struct RDMSensorDefinition {
+    uint8_t type;
+    uint8_t unit;
+    uint8_t prefix;
+    int16_t rangeMin;
+    int16_t rangeMax;
+    int16_t normalMin;
+    int16_t normalMax;
+    const char* description;
+};
+
+#define SENS_FREQUENCY 0x03
+#define SENS_TIME 0x10
+#define SENS_MEMORY 0x1D
+#define SENS_OTHER 0x7F
+#define UNITS_NONE 0x00
+#define UNITS_HERTZ 0x08
+#define UNITS_SECOND 0x15
+#define UNITS_BYTE 0x1C
+#define PREFIX_NONE 0x00
+#define PREFIX_MICRO 0x04
+#define PREFIX_KILO 0x13
+
+#define DMX_MAX_FRAME_RATE 830  // 最短帧(Break到Break 1204us)的帧率, 短宇宙可达到
+
+static constexpr RDMSensorDefinition sensorDefinitions[METRIC_COUNT] = {
+    { SENS_FREQUENCY, UNITS_HERTZ,  PREFIX_NONE,  0,    32767, 0,    1000,  "ArtDmx Packets/s" },
+    { SENS_FREQUENCY, UNITS_HERTZ,  PREFIX_NONE,  0,    DMX_MAX_FRAME_RATE, 20, DMX_MAX_FRAME_RATE, "DMX A Frame Rate" },
+    { SENS_FREQUENCY, UNITS_HERTZ,  PREFIX_NONE,  0,    DMX_MAX_FRAME_RATE, 20, DMX_MAX_FRAME_RATE, "DMX B Frame Rate" },
+    { SENS_TIME,      UNITS_SECOND, PREFIX_MICRO, 0,    32767, 0,    20000, "Pixel Show Time" },
+    { SENS_MEMORY,    UNITS_BYTE,   PREFIX_KILO,  0,    512,   32,   512,   "Free Heap" },
+    { SENS_OTHER,     UNITS_NONE,   PREFIX_NONE,  -128, 0,     -75,  0,     "WiFi RSSI (dBm)" },
+    { SENS_FREQUENCY, UNITS_HERTZ,  PREFIX_NONE,  0,    32767, 0,    0,     "Dropped Packets/s" },
+};
+
+// PID注册表: 新增参数只需加一项
+constexpr RDMParameter RDMHandler::parameters[] = {
+    // PID                            GET  SET最小/最大     GET处理函数                          SET处理函数
+    { PARAM_SUPPORTED_PARAMETERS,     0,   0, 0,                 &RDMHandler::getSupportedParameters,  nullptr },
+    { PARAM_DEVICE_INFO,              0,   0, 0,                 &RDMHandler::getDeviceInfo,           nullptr },
+    { PARAM_DEVICE_MODEL_DESCRIPTION, 0,   0, 0,                 &RDMHandler::getModelDescription,     nullptr },
+    { PARAM_MANUFACTURER_LABEL,       0,   0, 0,                 &RDMHandler::getManufacturerLabel,    nullptr },
+    { PARAM_DEVICE_LABEL,             0,   0, RDM_LABEL_LENGTH,  &RDMHandler::getDeviceLabel,          &RDMHandler::setDeviceLabel },
+    { PARAM_SOFTWARE_VERSION_LABEL,   0,   0, 0,                 &RDMHandler::getSoftwareVersionLabel, nullptr },
+    { PARAM_DMX_START_ADDRESS,        0,   2, 2,                 &RDMHandler::getStartAddress,         &RDMHandler::setStartAddress },
+    { PARAM_SENSOR_DEFINITION,        1,   0, 0,                 &RDMHandler::getSensorDefinition,     nullptr },
+    { PARAM_SENSOR_VALUE,             1,   1, 1,                 &RDMHandler::getSensorValue,          &RDMHandler::setSensorValue },
+    { PARAM_RECORD_SENSORS,           0,   1, 1,                 nullptr,                              &RDMHandler::setRecordSensors },
+    { PARAM_IDENTIFY_DEVICE,          0,   1, 1,                 &RDMHandler::getIdentifyDevice,       &RDMHandler::setIdentifyDevice },
+};
+
+const uint8_t RDMHandler::parameterCount = sizeof(RDMHandler::parameters) / sizeof(RDMHandler::parameters[0]);
 
 // 构造函数，初始化成员变量
 RDMHandler::RDMHandler() : 
     dmxPort(nullptr),
     discoveryEnabled(true),
-    respondToDiscovery(false),
-    transactionNumber(0) {
+    respondToDiscovery(false) {
     generateUID();
     memset(&deviceInfo, 0, sizeof(DeviceInfo));
     strcpy(deviceInfo.manufacturer, "ACME");
@@ -16,6 +71,7 @@ RDMHandler::RDMHandler() :
     deviceInfo.dmxStartAddress = 1;
     deviceInfo.powerCycles = 0;
     deviceInfo.identifyMode = false;
+    memset(responseFrame, 0, sizeof(responseFrame));
 }
 
 // 析构函数
@@ -37,161 +93,242 @@ void RDMHandler::update() {
     // 周期性更新，如果需要的话
 }
 
-// 处理RDM命令
-void RDMHandler::handleCommand(uint8_t* data, uint16_t length) {
-    if (!data || length < sizeof(RDMHeader)) return;
+// 处理RDM命令: 校验后按注册表分发, 应答一次写入 responseFrame
+uint16_t RDMHandler::handleCommand(const uint8_t* data, uint16_t length) {
+    if (!data || !rdmValidate(data, length)) return 0;
+
+    const uint8_t* destination = data + RDM_OFFSET_DEST;
+    bool broadcast = isRDMBroadcast(destination);
+    if (!broadcast && memcmp(destination, uid.id, RDM_UID_LENGTH) != 0) {
+        return 0;
+    }
+
+    uint8_t commandClass = data[RDM_OFFSET_CC];
+    if (commandClass == RDM_DISCOVERY_COMMAND) {
+        if (discoveryEnabled) handleDiscovery(data);
+        return 0;
+    }
+    if (commandClass != RDM_GET_COMMAND && commandClass != RDM_SET_COMMAND) {
+        return 0;
+    }
+
+    RDMWriter out(responseFrame);
+    uint16_t result = dispatch(data, out);
+    if (broadcast) {
+        return 0;  // 广播命令只执行不应答
+    }
+    if (!out.ok()) result = RDM_NR_FORMAT_ERROR;  // 参数数据溢出时按格式错误NACK
+    if (result != RDM_ACK) {
+        out.reset();
+        out.writeU16(result);
+    }
 
-    RDMHeader* header = (RDMHeader*)data;
-    if (!validateHeader(header)) return;
+    // 应答头: 目标为请求方, 回显事务号/子设备/PID
+    uint8_t* frame = out.header();
+    frame[0] = 0xCC;
+    frame[1] = RDM_SUB_START_CODE;
+    memcpy(frame + RDM_OFFSET_DEST, data + RDM_OFFSET_SOURCE, RDM_UID_LENGTH);
+    memcpy(frame + RDM_OFFSET_SOURCE, uid.id, RDM_UID_LENGTH);
+    frame[RDM_OFFSET_TN] = data[RDM_OFFSET_TN];
+    frame[RDM_OFFSET_PORT] = result == RDM_ACK ? RDM_RESPONSE_ACK : RDM_RESPONSE_NACK;
+    frame[RDM_OFFSET_MSG_COUNT] = 0;
+    memcpy(frame + RDM_OFFSET_SUB_DEVICE, data + RDM_OFFSET_SUB_DEVICE, 2);
+    frame[RDM_OFFSET_CC] = commandClass + 1;
+    memcpy(frame + RDM_OFFSET_PID, data + RDM_OFFSET_PID, 2);
+    return out.finish();
+}
 
-    switch (header->commandClass) {
-        case RDM_DISCOVERY_COMMAND:
-            if (discoveryEnabled) handleDiscovery(header);
-            break;
-        case RDM_GET_COMMAND:
-            handleGetCommand(header);
-            break;
-        case RDM_SET_COMMAND:
-            handleSetCommand(header);
-            break;
+const RDMParameter* RDMHandler::findParameter(uint16_t pid) {
+    for (uint8_t i = 0; i < parameterCount; i++) {
+        if (parameters[i].pid == pid) return &parameters[i];
     }
+    return nullptr;
+}
+
+// 检查命令类、子设备和参数长度后调用处理函数
+uint16_t RDMHandler::dispatch(const uint8_t* request, RDMWriter& out) {
+    const RDMParameter* param = findParameter(rdmRead16(request + RDM_OFFSET_PID));
+    if (!param) return RDM_NR_UNKNOWN_PID;
+
+    uint16_t subDevice = rdmRead16(request + RDM_OFFSET_SUB_DEVICE);
+    RDMReader in(request + RDM_HEADER_SIZE, request[RDM_OFFSET_PDL]);
+
+    if (request[RDM_OFFSET_CC] == RDM_GET_COMMAND) {
+        if (!param->get) return RDM_NR_UNSUPPORTED_COMMAND_CLASS;
+        if (subDevice != 0) return RDM_NR_SUB_DEVICE_OUT_OF_RANGE;
+        if (in.size() != param->getSize) return RDM_NR_FORMAT_ERROR;
+        return (this->*param->get)(in, out);
+    }
+
+    if (!param->set) return RDM_NR_UNSUPPORTED_COMMAND_CLASS;
+    if (subDevice != 0 && subDevice != 0xFFFF) return RDM_NR_SUB_DEVICE_OUT_OF_RANGE;
+    if (in.size() < param->setMinSize || in.size() > param->setMaxSize) return RDM_NR_FORMAT_ERROR;
+    return (this->*param->set)(in, out);
 }
 
 // 处理发现命令
-void RDMHandler::handleDiscovery(RDMHeader* header) {
-    if (!isRDMBroadcast(&header->destinationUID)) return;
-
-    // 准备发现响应
-    uint8_t response[sizeof(RDMHeader) + 24];
-    RDMHeader* respHeader = (RDMHeader*)response;
-    prepareResponse(header, RDM_DISCOVERY_RESPONSE);
-
-    // 发送响应
-    if (dmxPort) {
-        dmxPort->sendRDM(response, sizeof(RDMHeader) + 24);
-    }
-}
-
-// 处理GET命令
-void RDMHandler::handleGetCommand(RDMHeader* header) {
-    if (!dmxPort) return;
-    
-    if (memcmp(&header->destinationUID, &uid, sizeof(RDMUID)) != 0 && 
-        !isRDMBroadcast(&header->destinationUID)) {
-        return;
-    }
-
-    switch (header->parameterID) {
-        case PARAM_DEVICE_INFO:
-            handleDeviceInfo(header);
-            break;
-        case PARAM_DMX_START_ADDRESS:
-            handleDMXStartAddress(header);
-            break;
-        // 处理其他GET参数
-    }
-}
-
-// 处理SET命令
-void RDMHandler::handleSetCommand(RDMHeader* header) {
-    if (!dmxPort) return;
-    
-    if (memcmp(&header->destinationUID, &uid, sizeof(RDMUID)) != 0 && 
-        !isRDMBroadcast(&header->destinationUID)) {
-        return;
-    }
-
-    switch (header->parameterID) {
-        case PARAM_DMX_START_ADDRESS:
-            handleDMXStartAddress(header);
-            break;
-        case PARAM_IDENTIFY_DEVICE:
-            handleIdentifyDevice(header);
-            break;
-        // 处理其他SET参数
-    }
-}
-
-// 处理设备信息
-void RDMHandler::handleDeviceInfo(RDMHeader* header) {
-    struct DeviceInfoResponse {
-        uint16_t protocolVersion;
-        uint16_t deviceModel;
-        uint16_t productCategory;
-        uint32_t softwareVersion;
-        uint16_t dmxFootprint;
-        uint16_t dmxPersonality;
-        uint16_t dmxStartAddress;
-        uint16_t subDeviceCount;
-        uint8_t sensorCount;
-    } response;
-
-    response.protocolVersion = 0x0100;  // RDM V1.0
-    response.deviceModel = 0x0001;
-    response.productCategory = 0x0101;  // DMX512 Receiver
-    response.softwareVersion = 0x00000100;
-    response.dmxFootprint = 512;
-    response.dmxPersonality = 1;
-    response.dmxStartAddress = deviceInfo.dmxStartAddress;
-    response.subDeviceCount = 0;
-    response.sensorCount = 0;
-
-    // 准备并发送响应
-    uint8_t respBuffer[sizeof(RDMHeader) + sizeof(DeviceInfoResponse)];
-    RDMHeader* respHeader = (RDMHeader*)respBuffer;
-    prepareResponse(header, RDM_GET_COMMAND_RESPONSE);
-    memcpy(respBuffer + sizeof(RDMHeader), &response, sizeof(DeviceInfoResponse));
-    
-    if (dmxPort) {
-        dmxPort->sendRDM(respBuffer, sizeof(respBuffer));
-    }
-}
-
-// 处理DMX起始地址
-void RDMHandler::handleDMXStartAddress(RDMHeader* header) {
-    if (header->commandClass == RDM_GET_COMMAND) {
-        // 准备并发送GET响应
-        uint8_t respBuffer[sizeof(RDMHeader) + 2];
-        RDMHeader* respHeader = (RDMHeader*)respBuffer;
-        prepareResponse(header, RDM_GET_COMMAND_RESPONSE);
-        uint16_t* addr = (uint16_t*)(respBuffer + sizeof(RDMHeader));
-        *addr = deviceInfo.dmxStartAddress;
-        
-        if (dmxPort) {
-            dmxPort->sendRDM(respBuffer, sizeof(respBuffer));
+// DMX端口上本机是控制器(发现由 RDMDiscovery 完成), 不应答其他控制器的发现
+void RDMHandler::handleDiscovery(const uint8_t* request) {
+    (void)request;
+}
+
+uint16_t RDMHandler::getSupportedParameters(RDMReader& in, RDMWriter& out) {
+    for (uint8_t i = 0; i < parameterCount; i++) {
+        if (parameters[i].pid != PARAM_SUPPORTED_PARAMETERS) {
+            out.writeU16(parameters[i].pid);
         }
-    } else if (header->commandClass == RDM_SET_COMMAND) {
-        // 处理SET命令
-        uint16_t newAddress = *(uint16_t*)(((uint8_t*)header) + sizeof(RDMHeader));
-        if (newAddress > 0 && newAddress <= 512) {
-            deviceInfo.dmxStartAddress = newAddress;
+    }
+    return RDM_ACK;
+}
+
+uint16_t RDMHandler::getDeviceInfo(RDMReader& in, RDMWriter& out) {
+    out.writeU16(0x0100);                   // RDM V1.0
+    out.writeU16(0x0001);                   // 设备型号
+    out.writeU16(0x0101);                   // DMX512 Receiver
+    out.writeU32(0x00000100);               // 软件版本
+    out.writeU16(512);                      // DMX占用通道数
+    out.writeU8(1);                         // 当前模式
+    out.writeU8(1);                         // 模式数
+    out.writeU16(deviceInfo.dmxStartAddress);
+    out.writeU16(0);                        // 子设备数
+    out.writeU8(METRIC_COUNT);              // 传感器数
+    return RDM_ACK;
+}
+
+uint16_t RDMHandler::getModelDescription(RDMReader& in, RDMWriter& out) {
+    out.writeString(deviceInfo.model);
+    return RDM_ACK;
+}
+
+uint16_t RDMHandler::getManufacturerLabel(RDMReader& in, RDMWriter& out) {
+    out.writeString(deviceInfo.manufacturer);
+    return RDM_ACK;
+}
+
+uint16_t RDMHandler::getDeviceLabel(RDMReader& in, RDMWriter& out) {
+    out.writeString(deviceInfo.label);
+    return RDM_ACK;
+}
+
+uint16_t RDMHandler::setDeviceLabel(RDMReader& in, RDMWriter& out) {
+    uint8_t length = in.size();
+    memcpy(deviceInfo.label, in.readBytes(length), length);
+    deviceInfo.label[length] = '\0';
+    return RDM_ACK;
+}
+
+uint16_t RDMHandler::getSoftwareVersionLabel(RDMReader& in, RDMWriter& out) {
+    out.writeString(FIRMWARE_VERSION);
+    return RDM_ACK;
+}
+
+uint16_t RDMHandler::getStartAddress(RDMReader& in, RDMWriter& out) {
+    out.writeU16(deviceInfo.dmxStartAddress);
+    return RDM_ACK;
+}
+
+uint16_t RDMHandler::setStartAddress(RDMReader& in, RDMWriter& out) {
+    uint16_t address = in.readU16();
+    if (address == 0 || address > 512) {
+        return RDM_NR_DATA_OUT_OF_RANGE;
+    }
+    deviceInfo.dmxStartAddress = address;
+    return RDM_ACK;
+}
+
+uint16_t RDMHandler::getIdentifyDevice(RDMReader& in, RDMWriter& out) {
+    out.writeU8(deviceInfo.identifyMode ? 1 : 0);
+    return RDM_ACK;
+}
+
+uint16_t RDMHandler::setIdentifyDevice(RDMReader& in, RDMWriter& out) {
+    uint8_t mode = in.readU8();
+    if (mode > 1) {
+        return RDM_NR_DATA_OUT_OF_RANGE;
+    }
+    deviceInfo.identifyMode = mode != 0;
+    return RDM_ACK;
+}
+
+uint16_t RDMHandler::getSensorDefinition(RDMReader& in, RDMWriter& out) {
+    uint8_t sensor = in.readU8();
+    if (sensor >= METRIC_COUNT) {
+        return RDM_NR_DATA_OUT_OF_RANGE;
+    }
+
+    const RDMSensorDefinition& def = sensorDefinitions[sensor];
+    out.writeU8(sensor);
+    out.writeU8(def.type);
+    out.writeU8(def.unit);
+    out.writeU8(def.prefix);
+    out.writeU16(def.rangeMin);
+    out.writeU16(def.rangeMax);
+    out.writeU16(def.normalMin);
+    out.writeU16(def.normalMax);
+    out.writeU8(0x03);                      // 支持记录值和最小/最大值
+    out.writeString(def.description);
+    return RDM_ACK;
+}
+
+void RDMHandler::writeSensorValue(uint8_t sensor, RDMWriter& out) {
+    out.writeU8(sensor);
+    out.writeU16(gMetrics.value[sensor]);
+    out.writeU16(gMetrics.lowest[sensor]);
+    out.writeU16(gMetrics.highest[sensor]);
+    out.writeU16(gMetrics.recorded[sensor]);
+}
+
+uint16_t RDMHandler::getSensorValue(RDMReader& in, RDMWriter& out) {
+    uint8_t sensor = in.readU8();
+    if (sensor >= METRIC_COUNT) {
+        return RDM_NR_DATA_OUT_OF_RANGE;
+    }
+    writeSensorValue(sensor, out);
+    return RDM_ACK;
+}
+
+// SET SENSOR_VALUE: 重置最小/最大值, 0xFF 表示全部传感器
+uint16_t RDMHandler::setSensorValue(RDMReader& in, RDMWriter& out) {
+    uint8_t sensor = in.readU8();
+    if (sensor == RDM_SENSOR_ALL) {
+        for (uint8_t i = 0; i < METRIC_COUNT; i++) {
+            gMetrics.resetRange(i);
         }
+        out.writeU8(RDM_SENSOR_ALL);
+        out.writeU16(0);
+        out.writeU16(0);
+        out.writeU16(0);
+        out.writeU16(0);
+        return RDM_ACK;
     }
+    if (sensor >= METRIC_COUNT) {
+        return RDM_NR_DATA_OUT_OF_RANGE;
+    }
+    gMetrics.resetRange(sensor);
+    writeSensorValue(sensor, out);
+    return RDM_ACK;
 }
 
-// 处理设备识别
-void RDMHandler::handleIdentifyDevice(RDMHeader* header) {
-    if (header->commandClass == RDM_GET_COMMAND) {
-        // 发送当前识别状态
-        uint8_t respBuffer[sizeof(RDMHeader) + 1];
-        RDMHeader* respHeader = (RDMHeader*)respBuffer;
-        prepareResponse(header, RDM_GET_COMMAND_RESPONSE);
-        respBuffer[sizeof(RDMHeader)] = deviceInfo.identifyMode ? 1 : 0;
-        
-        if (dmxPort) {
-            dmxPort->sendRDM(respBuffer, sizeof(respBuffer));
+uint16_t RDMHandler::setRecordSensors(RDMReader& in, RDMWriter& out) {
+    uint8_t sensor = in.readU8();
+    if (sensor == RDM_SENSOR_ALL) {
+        for (uint8_t i = 0; i < METRIC_COUNT; i++) {
+            gMetrics.record(i);
         }
-    } else if (header->commandClass == RDM_SET_COMMAND) {
-        // 设置识别模式
-        deviceInfo.identifyMode = *(((uint8_t*)header) + sizeof(RDMHeader)) != 0;
+        return RDM_ACK;
+    }
+    if (sensor >= METRIC_COUNT) {
+        return RDM_NR_DATA_OUT_OF_RANGE;
     }
+    gMetrics.record(sensor);
+    return RDM_ACK;
 }
 
 // 设置设备信息
 void RDMHandler::setDeviceInfo(const char* manufacturer, const char* model, const char* label) {
-    strncpy(deviceInfo.manufacturer, manufacturer, sizeof(deviceInfo.manufacturer) - 1);
-    strncpy(deviceInfo.model, model, sizeof(deviceInfo.model) - 1);
-    strncpy(deviceInfo.label, label, sizeof(deviceInfo.label) - 1);
+    strncpy(deviceInfo.manufacturer, manufacturer, RDM_LABEL_LENGTH);
+    strncpy(deviceInfo.model, model, RDM_LABEL_LENGTH);
+    strncpy(deviceInfo.label, label, RDM_LABEL_LENGTH);
 }
 
 // 设置DMX起始地址
@@ -206,13 +343,6 @@ void RDMHandler::enableDiscovery(bool enable) {
     discoveryEnabled = enable;
 }
 
-// 验证RDM头
-bool RDMHandler::validateHeader(RDMHeader* header) {
-    return header->startCode == 0xCC && 
-           header->subStartCode == RDM_SUB_START_CODE &&
-           header->messageLength >= sizeof(RDMHeader);
-}
-
 // 生成唯一标识符UID
 void RDMHandler::generateUID() {
     uint8_t mac[6];
@@ -222,22 +352,11 @@ void RDMHandler::generateUID() {
     uid.id[1] = 0x77;  // 可以改为你的实际制造商ID
 }
 
-// 检查是否为RDM广播
-bool RDMHandler::isRDMBroadcast(RDMUID* testUID) {
-    for (int i = 0; i < RDM_UID_LENGTH; i++) {
-        if (testUID->id[i] != 0xFF) return false;
+// 检查是否为RDM广播: 全部设备或本制造商的全部设备
+bool RDMHandler::isRDMBroadcast(const uint8_t* testUID) {
+    for (int i = 2; i < RDM_UID_LENGTH; i++) {
+        if (testUID[i] != 0xFF) return false;
     }
-    return true;
+    return (testUID[0] == 0xFF && testUID[1] == 0xFF) ||
+           (testUID[0] == uid.id[0] && testUID[1] == uid.id[1]);
 }
-
-// 准备RDM响应
-void RDMHandler::prepareResponse(RDMHeader* header, uint8_t cmdClass) {
-    header->startCode = 0xCC;
-    header->subStartCode = RDM_SUB_START_CODE;
-    // 交换源和目标UID
-    RDMUID tempUID = header->destinationUID;
-    header->destinationUID = header->sourceUID;
-    header->sourceUID = uid;
-    header->commandClass = cmdClass;
-    header->transactionNumber = transactionNumber++;
-}
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "ESP32DMX.h"
+#include "RDMCodec.h"
 
 #define RDM_SUB_START_CODE 0x01
 #define RDM_DISCOVERY_COMMAND 0x10
@@ -12,40 +13,62 @@
 #define RDM_GET_COMMAND_RESPONSE 0x21
 #define RDM_SET_COMMAND_RESPONSE 0x31
 
+#define PARAM_SUPPORTED_PARAMETERS 0x0050
 #define PARAM_DEVICE_INFO 0x0060
+#define PARAM_DEVICE_MODEL_DESCRIPTION 0x0080
+#define PARAM_MANUFACTURER_LABEL 0x0081
+#define PARAM_DEVICE_LABEL 0x0082
+#define PARAM_SOFTWARE_VERSION_LABEL 0x00C0
 #define PARAM_DMX_START_ADDRESS 0x00F0
+#define PARAM_SENSOR_DEFINITION 0x0200
+#define PARAM_SENSOR_VALUE 0x0201
+#define PARAM_RECORD_SENSORS 0x0202
 #define PARAM_IDENTIFY_DEVICE 0x1000
 
+#define RDM_SENSOR_ALL 0xFF
+
+// 应答类型与NACK原因
+#define RDM_RESPONSE_ACK 0x00
+#define RDM_RESPONSE_NACK 0x02
+#define RDM_NR_UNKNOWN_PID 0x0000
+#define RDM_NR_FORMAT_ERROR 0x0001
+#define RDM_NR_UNSUPPORTED_COMMAND_CLASS 0x0005
+#define RDM_NR_DATA_OUT_OF_RANGE 0x0006
+#define RDM_NR_SUB_DEVICE_OUT_OF_RANGE 0x0009
+#define RDM_ACK 0xFFFF  // 参数处理函数返回值: 应答ACK
+
 #define RDM_UID_LENGTH 6
+#define RDM_LABEL_LENGTH 32
 
 struct RDMUID {
     uint8_t id[RDM_UID_LENGTH];
 };
 
-struct RDMHeader {
-    uint8_t startCode;
-    uint8_t subStartCode;
-    uint8_t messageLength;
-    RDMUID destinationUID;
-    RDMUID sourceUID;
-    uint8_t transactionNumber;
-    uint8_t portID;
-    uint8_t messageCount;
-    uint16_t subDevice;
-    uint8_t commandClass;
-    uint16_t parameterID;
-    uint16_t parameterLength;
-};
-
 struct DeviceInfo {
-    char manufacturer[32];
-    char model[32];
-    char label[32];
+    char manufacturer[RDM_LABEL_LENGTH + 1];
+    char model[RDM_LABEL_LENGTH + 1];
+    char label[RDM_LABEL_LENGTH + 1];
     uint16_t dmxStartAddress;
     uint32_t powerCycles;
     bool identifyMode;
 };
 
+class RDMHandler;
+
+// 参数处理函数: 从 in 解码请求参数, 向 out 写应答参数,
+// 返回 RDM_ACK 或 NACK 原因
+typedef uint16_t (RDMHandler::*RDMParamHandler)(RDMReader& in, RDMWriter& out);
+
+// PID注册表项, 支持的命令类由 get/set 是否为空决定
+struct RDMParameter {
+    uint16_t pid;
+    uint8_t getSize;        // GET请求的参数长度
+    uint8_t setMinSize;     // SET请求的参数长度范围
+    uint8_t setMaxSize;
+    RDMParamHandler get;
+    RDMParamHandler set;
+};
+
 class RDMHandler {
 public:
     RDMHandler();
@@ -54,29 +77,46 @@ public:
     void begin();
     void begin(ESP32DMX* dmx);
     void update();
-    void handleCommand(uint8_t* data, uint16_t length);
+    // 处理一条RDM请求, 返回应答长度(0为不应答), 应答在 getResponse()
+    uint16_t handleCommand(const uint8_t* data, uint16_t length);
+    const uint8_t* getResponse() const { return responseFrame; }
     void setDeviceInfo(const char* manufacturer, const char* model, const char* label);
     void setDMXStartAddress(uint16_t address);
     void enableDiscovery(bool enable);
 
 private:
+    static const RDMParameter parameters[];
+    static const uint8_t parameterCount;
+
     ESP32DMX* dmxPort;
     RDMUID uid;
     DeviceInfo deviceInfo;
     bool discoveryEnabled;
     bool respondToDiscovery;
-    uint8_t transactionNumber;
+    uint8_t responseFrame[RDM_MAX_PACKET];
 
     void generateUID();
-    bool validateHeader(RDMHeader* header);
-    bool isRDMBroadcast(RDMUID* testUID);
-    void prepareResponse(RDMHeader* header, uint8_t cmdClass);
-    void handleDiscovery(RDMHeader* header);
-    void handleGetCommand(RDMHeader* header);
-    void handleSetCommand(RDMHeader* header);
-    void handleDeviceInfo(RDMHeader* header);
-    void handleDMXStartAddress(RDMHeader* header);
-    void handleIdentifyDevice(RDMHeader* header);
+    bool isRDMBroadcast(const uint8_t* testUID);
+    const RDMParameter* findParameter(uint16_t pid);
+    uint16_t dispatch(const uint8_t* request, RDMWriter& out);
+    void handleDiscovery(const uint8_t* request);
+
+    uint16_t getSupportedParameters(RDMReader& in, RDMWriter& out);
+    uint16_t getDeviceInfo(RDMReader& in, RDMWriter& out);
+    uint16_t getModelDescription(RDMReader& in, RDMWriter& out);
+    uint16_t getManufacturerLabel(RDMReader& in, RDMWriter& out);
+    uint16_t getDeviceLabel(RDMReader& in, RDMWriter& out);
+    uint16_t setDeviceLabel(RDMReader& in, RDMWriter& out);
+    uint16_t getSoftwareVersionLabel(RDMReader& in, RDMWriter& out);
+    uint16_t getStartAddress(RDMReader& in, RDMWriter& out);
+    uint16_t setStartAddress(RDMReader& in, RDMWriter& out);
+    uint16_t getIdentifyDevice(RDMReader& in, RDMWriter& out);
+    uint16_t setIdentifyDevice(RDMReader& in, RDMWriter& out);
+    uint16_t getSensorDefinition(RDMReader& in, RDMWriter& out);
+    uint16_t getSensorValue(RDMReader& in, RDMWriter& out);
+    uint16_t setSensorValue(RDMReader& in, RDMWriter& out);
+    uint16_t setRecordSensors(RDMReader& in, RDMWriter& out);
+    void writeSensorValue(uint8_t sensor, RDMWriter& out);
 };
 
 #endif // RDMHANDLER_H
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "RDMTod.h"
+
+RDMTod::RDMTod()
+    : uidCount(0)
+    , generation(0) {
+}
+
+bool RDMTod::add(const uint8_t* uid) {
+    if (indexOf(uid) >= 0) {
+        return true;
+    }
+    if (uidCount >= RDM_TOD_MAX) {
+        return false;
+    }
+    memcpy(uids[uidCount++].id, uid, RDM_UID_LENGTH);
+    generation++;
+    return true;
+}
+
+// 用最后一项填补空位, 顺序不重要
+bool RDMTod::remove(const uint8_t* uid) {
+    int16_t index = indexOf(uid);
+    if (index < 0) {
+        return false;
+    }
+    uids[index] = uids[--uidCount];
+    generation++;
+    return true;
+}
+
+void RDMTod::clear() {
+    if (uidCount) {
+        uidCount = 0;
+        generation++;
+    }
+}
+
+int16_t RDMTod::indexOf(const uint8_t* uid) const {
+    for (uint16_t i = 0; i < uidCount; i++) {
+        if (memcmp(uids[i].id, uid, RDM_UID_LENGTH) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <Arduino.h>
+#include "RDMHandler.h"
+
+#define RDM_TOD_MAX 128  // 每个端口缓存的设备数
+
+// 设备表(Table of Devices): 一个DMX端口上已发现的RDM设备UID
+class RDMTod {
+public:
+    RDMTod();
+
+    bool add(const uint8_t* uid);
+    bool remove(const uint8_t* uid);
+    bool contains(const uint8_t* uid) const { return indexOf(uid) >= 0; }
+    void clear();
+
+    uint16_t count() const { return uidCount; }
+    const RDMUID& get(uint16_t index) const { return uids[index]; }
+    uint32_t getGeneration() const { return generation; }  // 每次变化加1
+
+private:
+    RDMUID uids[RDM_TOD_MAX];
+    uint16_t uidCount;
+    uint32_t generation;
+
+    int16_t indexOf(const uint8_t* uid) const;
+};
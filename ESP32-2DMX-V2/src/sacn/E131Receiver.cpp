@@ -0,0 +1,262 @@
+#include "E131Receiver.h"
+#include "lwip/sockets.h"
+#include "NodeMetrics.h"
+
+const uint8_t E131Receiver::ACN_ID[12] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+
+E131Receiver::E131Receiver(ArtnetNode* node)
+    : node(node)
+    , sock(-1)
+    , routeGeneration(0)
+    , joinedCount(0) {
+    memset(&stats, 0, sizeof(Stats));
+    memset(joined, 0, sizeof(joined));
+    memset(sources, 0, sizeof(sources));
+}
+
+E131Receiver::~E131Receiver() {
+    end();
+}
+
+bool E131Receiver::begin() {
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        log_e("sACN socket create failed");
+        return false;
+    }
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(E131_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        log_e("sACN bind failed");
+        end();
+        return false;
+    }
+
+    // 非阻塞, 由网络任务轮询
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+
+    syncGroups();
+    return true;
+}
+
+void E131Receiver::end() {
+    if (sock >= 0) {
+        close(sock);
+        sock = -1;
+    }
+    joinedCount = 0;
+}
+
+void E131Receiver::update() {
+    if (sock < 0) return;
+
+    // 路由表变化时重新加入组播组
+    if (routeGeneration != node->getRouteGeneration()) {
+        syncGroups();
+    }
+
+    for (uint8_t i = 0; i < ARTNET_RX_BUDGET; i++) {
+        struct sockaddr_in from;
+        socklen_t fromLength = sizeof(from);
+        int length = recvfrom(sock, packet, sizeof(packet), MSG_DONTWAIT,
+                              (struct sockaddr*)&from, &fromLength);
+        if (length <= 0) return;
+        processPacket(length, from.sin_addr.s_addr);
+    }
+}
+
+// 离开不再路由的宇宙, 加入新路由的宇宙
+void E131Receiver::syncGroups() {
+    routeGeneration = node->getRouteGeneration();
+
+    uint16_t wanted[ARTNET_MAX_ROUTES];
+    uint8_t wantedCount = node->getRouteCount();
+    for (uint8_t i = 0; i < wantedCount; i++) {
+        wanted[i] = node->getRoute(i).portAddress + 1;
+    }
+
+    for (uint8_t i = 0; i < joinedCount; ) {
+        bool keep = false;
+        for (uint8_t j = 0; j < wantedCount; j++) {
+            if (wanted[j] == joined[i]) {
+                keep = true;
+                break;
+            }
+        }
+        if (keep) {
+            i++;
+            continue;
+        }
+        setMembership(joined[i], false);
+        joined[i] = joined[--joinedCount];
+    }
+
+    for (uint8_t j = 0; j < wantedCount; j++) {
+        if (findJoined(wanted[j]) < 0 && setMembership(wanted[j], true)) {
+            joined[joinedCount++] = wanted[j];
+        }
+    }
+
+    // 路由下标可能已变, 源状态重新开始
+    memset(sources, 0, sizeof(sources));
+}
+
+// 组播地址 239.255.<宇宙高字节>.<宇宙低字节>
+bool E131Receiver::setMembership(uint16_t universe, bool join) {
+    struct ip_mreq mreq = {};
+    mreq.imr_multiaddr.s_addr = htonl(0xEFFF0000 | universe);
+    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (setsockopt(sock, IPPROTO_IP, join ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP,
+                   &mreq, sizeof(mreq)) < 0) {
+        log_w("sACN %s universe %u failed", join ? "join" : "leave", universe);
+        return false;
+    }
+    return true;
+}
+
+int8_t E131Receiver::findJoined(uint16_t universe) const {
+    for (uint8_t i = 0; i < joinedCount; i++) {
+        if (joined[i] == universe) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void E131Receiver::processPacket(int length, uint32_t sourceIp) {
+    // 根层: 前导码, ACN标识, 向量 VECTOR_ROOT_E131_DATA
+    // 帧层: 向量 VECTOR_E131_DATA_PACKET; DMP层: 向量0x02, 地址类型0xA1
+    if (length < E131_HEADER_SIZE ||
+        packet[0] != 0x00 || packet[1] != 0x10 ||
+        memcmp(&packet[4], ACN_ID, sizeof(ACN_ID)) != 0 ||
+        packet[21] != 0x04 || packet[43] != 0x02 ||
+        packet[117] != 0x02 || packet[118] != 0xA1) {
+        stats.packetsDropped++;
+        gMetrics.countDropped();
+        return;
+    }
+
+    uint8_t priority = packet[108];
+    uint8_t sequence = packet[111];
+    uint8_t options = packet[112];
+    uint16_t universe = (packet[113] << 8) | packet[114];
+    uint16_t propertyCount = (packet[123] << 8) | packet[124];
+
+    // 预览数据不输出, 只处理起始码为0的DMX数据
+    if ((options & E131_OPTION_PREVIEW) || universe == 0 || universe > E131_MAX_UNIVERSE ||
+        packet[125] != 0x00) {
+        stats.packetsDropped++;
+        gMetrics.countDropped();
+        return;
+    }
+
+    // 宇宙号减1即端口地址, 超出15位的宇宙本节点无法路由, 不能让 findRoute 截断后落到低端口
+    if (universe - 1 > 0x7FFF) {
+        stats.packetsDropped++;
+        gMetrics.countDropped();
+        return;
+    }
+
+    const ArtnetNode::Route* route = node->findRoute(universe - 1);
+    if (!route) {
+        stats.packetsDropped++;
+        gMetrics.countDropped();
+        return;
+    }
+    uint8_t routeIndex = route - &node->getRoute(0);
+
+    uint32_t key;
+    if (!acceptSource(routeIndex, &packet[E131_CID_OFFSET], sourceIp, priority, sequence,
+                      options & E131_OPTION_TERMINATED, key)) {
+        return;
+    }
+    stats.packetsProcessed++;
+
+    uint16_t slots = propertyCount ? propertyCount - 1 : 0;
+    if (slots > length - E131_HEADER_SIZE) {
+        slots = length - E131_HEADER_SIZE;
+    }
+    if (slots > ARTNET_DMX_LENGTH) {
+        slots = ARTNET_DMX_LENGTH;
+    }
+    node->outputFrame(route, key, &packet[E131_HEADER_SIZE], slots);
+}
+
+// 合并引擎按32位标识区分源, sACN源以CID的FNV-1a散列代替IP
+uint32_t E131Receiver::cidKey(const uint8_t* cid) {
+    uint32_t hash = 2166136261u;
+    for (uint8_t i = 0; i < E131_CID_LENGTH; i++) {
+        hash = (hash ^ cid[i]) * 16777619u;
+    }
+    return hash ? hash : 1;
+}
+
+// 序号检查(E1.31 6.7.2)与优先级仲裁: 只有最高优先级的源被输出,
+// 同一优先级的多个源交给合并引擎. 超时、终止或被更高优先级取代的源同时移出合并引擎
+bool E131Receiver::acceptSource(uint8_t routeIndex, const uint8_t* cid, uint32_t sourceIp,
+                                uint8_t priority, uint8_t sequence, bool terminated, uint32_t& key) {
+    Source* slots = sources[routeIndex];
+    Source* self = nullptr;
+    Source* freeSlot = nullptr;
+    uint32_t now = millis();
+
+    for (uint8_t i = 0; i < E131_MAX_SOURCES; i++) {
+        Source& source = slots[i];
+        if (source.key && now - source.lastSeen > E131_SOURCE_TIMEOUT) {
+            node->releaseMergeSource(routeIndex, source.key);
+            source.key = 0;
+        }
+        if (!source.key) {
+            if (!freeSlot) freeSlot = &source;
+        } else if (memcmp(source.cid, cid, E131_CID_LENGTH) == 0) {
+            self = &source;
+        }
+    }
+
+    if (self) {
+        int8_t diff = (int8_t)(sequence - self->sequence);
+        if (diff <= 0 && diff > -20) {
+            stats.outOfSequence++;
+            return false;
+        }
+    } else {
+        if (!freeSlot) {
+            stats.packetsDropped++;
+            gMetrics.countDropped();
+            return false;
+        }
+        self = freeSlot;
+        memcpy(self->cid, cid, E131_CID_LENGTH);
+        self->key = cidKey(cid);
+    }
+    key = self->key;
+
+    // 流终止: 立即释放该源, 不输出本包
+    if (terminated) {
+        self->key = 0;
+        node->releaseMergeSource(routeIndex, key);
+        return false;
+    }
+
+    self->ip = sourceIp;
+    self->sequence = sequence;
+    self->priority = priority;
+    self->lastSeen = now;
+
+    for (uint8_t i = 0; i < E131_MAX_SOURCES; i++) {
+        if (slots[i].key && slots[i].priority > priority) {
+            stats.lowerPriority++;
+            return false;
+        }
+    }
+    // 本源胜出: 低优先级源留在合并引擎中的旧快照不能再参与HTP/LTP
+    for (uint8_t i = 0; i < E131_MAX_SOURCES; i++) {
+        if (slots[i].key && slots[i].priority < priority) {
+            node->releaseMergeSource(routeIndex, slots[i].key);
+        }
+    }
+    return true;
+}
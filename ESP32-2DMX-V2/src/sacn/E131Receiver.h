@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "artnet/ArtnetNode.h"
+
+// E1.31 (sACN) 协议常量
+#define E131_PORT 5568
+#define E131_PACKET_SIZE 638           // 完整512槽位数据包
+#define E131_HEADER_SIZE 126           // 数据从第126字节开始
+#define E131_CID_OFFSET 22             // 根层CID, 16字节
+#define E131_CID_LENGTH 16
+#define E131_MAX_SOURCES 2             // 每个宇宙跟踪的源数, 与合并引擎一致
+#define E131_SOURCE_TIMEOUT 2500       // 网络数据丢失超时(ms)
+#define E131_MAX_UNIVERSE 63999        // 合法宇宙号 1~63999
+#define E131_OPTION_PREVIEW 0x80
+#define E131_OPTION_TERMINATED 0x40
+
+// sACN 接收器: 只加入已路由宇宙的组播组,
+// 按优先级和序号筛选后送入 ArtnetNode 的同一输出管线.
+// 源按根层CID区分, 同一主机上的多个源或NAT后的源互不干扰.
+// sACN 宇宙号 = Art-Net 端口地址 + 1
+class E131Receiver {
+public:
+    struct Stats {
+        uint32_t packetsProcessed;
+        uint32_t packetsDropped;     // 格式错误或非本节点宇宙
+        uint32_t outOfSequence;      // 序号落后而丢弃
+        uint32_t lowerPriority;      // 优先级低于当前最高源而丢弃
+    };
+
+    explicit E131Receiver(ArtnetNode* node);
+    ~E131Receiver();
+
+    bool begin();
+    void end();
+    void update();
+
+    const Stats& getStats() const { return stats; }
+    uint8_t getJoinedCount() const { return joinedCount; }
+
+private:
+    struct Source {
+        uint8_t cid[E131_CID_LENGTH];
+        uint32_t key;           // CID散列, 作为合并引擎中的源标识; 0 表示空闲
+        uint32_t ip;            // 发送方IP, 仅用于诊断
+        uint32_t lastSeen;
+        uint8_t priority;
+        uint8_t sequence;
+    };
+
+    ArtnetNode* node;
+    int sock;
+    Stats stats;
+    uint32_t routeGeneration;   // 已同步的路由表版本
+    uint16_t joined[ARTNET_MAX_ROUTES];  // 已加入的sACN宇宙
+    uint8_t joinedCount;
+    Source sources[ARTNET_MAX_ROUTES][E131_MAX_SOURCES];
+    uint8_t packet[E131_PACKET_SIZE];
+
+    void syncGroups();
+    bool setMembership(uint16_t universe, bool join);
+    void processPacket(int length, uint32_t sourceIp);
+    bool acceptSource(uint8_t routeIndex, const uint8_t* cid, uint32_t sourceIp, uint8_t priority,
+                      uint8_t sequence, bool terminated, uint32_t& key);
+    int8_t findJoined(uint16_t universe) const;
+    static uint32_t cidKey(const uint8_t* cid);
+
+    static const uint8_t ACN_ID[12];
+};
@@ -406,14 +406,38 @@ void WebServer::handleConfigUpdate(AsyncWebServerRequest* request, uint8_t* data
         newConfig.pixelCount = doc["pixelCount"];
     }
     if (doc.containsKey("pixelType")) {
-        newConfig.pixelType = doc["pixelType"];
+        // 取值与 PixelType 一致
+        uint8_t pixelType = doc["pixelType"];
+        if (pixelType > TYPE_WS2812_BRG) {
+            request->send(400, "text/plain", "Invalid pixelType");
+            return;
+        }
+        newConfig.pixelType = pixelType;
     }
     if (doc.containsKey("pixelEnabled")) {
         newConfig.pixelEnabled = doc["pixelEnabled"];
     }
 
+    // 两个结构体布局不同, 先读出完整配置, 只覆盖网页可编辑的字段
+    ConfigManager::Config saved;
+    if (!ConfigManager::load(saved)) {
+        ConfigManager::setDefaults(saved);
+    }
+    memcpy(saved.deviceName, newConfig.deviceName, sizeof(saved.deviceName));
+    saved.dhcpEnabled = newConfig.dhcpEnabled;
+    memcpy(saved.staticIP, newConfig.staticIP, sizeof(saved.staticIP));
+    memcpy(saved.staticMask, newConfig.staticMask, sizeof(saved.staticMask));
+    memcpy(saved.staticGateway, newConfig.staticGateway, sizeof(saved.staticGateway));
+    saved.artnetNet = newConfig.artnetNet;
+    saved.artnetSubnet = newConfig.artnetSubnet;
+    saved.artnetUniverse = newConfig.artnetUniverse;
+    saved.dmxStartAddress = newConfig.dmxStartAddress;
+    saved.pixelCount = newConfig.pixelCount;
+    saved.pixelType = newConfig.pixelType;
+    saved.pixelEnabled = newConfig.pixelEnabled;
+
     // 保存并应用新配置
-    if (ConfigManager::save((const ConfigManager::Config&)newConfig)) {
+    if (ConfigManager::save(saved)) {
         config = newConfig;  // 更新当前配置
         applyConfig();       // 应用新配置
 
@@ -602,12 +626,13 @@ bool WebServer::saveConfigFile() {
 // 应用当前配置
 void WebServer::applyConfig() {
     if (artnetNode) {
-        ArtnetNode::Config artnetConfig;
+        ArtnetNode::Config artnetConfig = artnetNode->getConfig();
         artnetConfig.net = config.artnetNet;
         artnetConfig.subnet = config.artnetSubnet;
         artnetConfig.universe = config.artnetUniverse;
         artnetConfig.dmxStartAddress = config.dmxStartAddress;
-        artnetNode->setConfig(artnetConfig);
+        artnetConfig.pixelCount = config.pixelCount;
+        artnetNode->postConfig(artnetConfig);  // 在网络任务中生效
     }
 
     // 应用网络配置
@@ -700,6 +725,16 @@ void WebServer::update() {
         doc["freeHeap"] = ESP.getFreeHeap();
         doc["rssi"] = WiFi.RSSI();
         doc["ap_enabled"] = isAPRunning();
+        if (artnetNode) {
+            const ArtnetNode::Stats& stats = artnetNode->getStats();
+            doc["artnetProcessed"] = stats.packetsProcessed;
+            doc["artnetDropped"] = stats.packetsDropped;
+            doc["artnetFiltered"] = stats.packetsFiltered;
+            doc["artnetBudgetHits"] = stats.budgetExhausted;
+            doc["artnetReordered"] = stats.framesReordered;
+            doc["artnetDuplicate"] = stats.framesDuplicate;
+            doc["artnetLost"] = stats.framesLost;
+        }
         if (isAPRunning()) {
             doc["ap_stations"] = WiFi.softAPgetStationNum();
             doc["ap_ip"] = WiFi.softAPIP().toString();